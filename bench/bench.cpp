@@ -0,0 +1,67 @@
+// Standalone benchmark of the native kernels of natPsoho
+//
+// Runs the same benchmarks as the R function 'benchmark_natpsoho' without R,
+// so the kernels can be profiled and compared between versions directly.
+//
+// Usage: bench [--n-vars 5,10,20] [--max-size 2,3,5] [--reps 10000]
+//              [--seed 0] [--format csv|json] [--out file]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "../src/include/bench.h"
+
+static std::vector<int> parse_list(const char *s){
+  std::vector<int> res;
+  std::stringstream in(s);
+  std::string item;
+
+  while(std::getline(in, item, ','))
+    res.push_back(std::atoi(item.c_str()));
+
+  return res;
+}
+
+int main(int argc, char **argv){
+  std::vector<int> n_vars = {5, 10, 20}, max_size = {2, 3, 5};
+  size_t reps = 10000;
+  uint64_t seed = 0;
+  std::string format = "csv", out_file;
+  std::vector<natBenchResult> res, part;
+
+  for(int i = 1; i + 1 < argc; i += 2){
+    if(!std::strcmp(argv[i], "--n-vars"))
+      n_vars = parse_list(argv[i + 1]);
+    else if(!std::strcmp(argv[i], "--max-size"))
+      max_size = parse_list(argv[i + 1]);
+    else if(!std::strcmp(argv[i], "--reps"))
+      reps = std::strtoull(argv[i + 1], nullptr, 10);
+    else if(!std::strcmp(argv[i], "--seed"))
+      seed = std::strtoull(argv[i + 1], nullptr, 10);
+    else if(!std::strcmp(argv[i], "--format"))
+      format = argv[i + 1];
+    else if(!std::strcmp(argv[i], "--out"))
+      out_file = argv[i + 1];
+    else{
+      std::fprintf(stderr, "Unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  for(int n : n_vars){
+    for(int m : max_size){
+      part = nat_bench_kernels(n, m, reps, seed);
+      res.insert(res.end(), part.begin(), part.end());
+    }
+  }
+
+  std::string text = format == "json" ? nat_bench_json(res) : nat_bench_csv(res);
+  if(out_file.empty())
+    std::cout << text;
+  else
+    std::ofstream(out_file) << text;
+
+  return 0;
+}
@@ -5,16 +5,68 @@
 
 using namespace Rcpp;
 
+// nat_bench_kernels_cpp
+Rcpp::DataFrame nat_bench_kernels_cpp(int n_vars, int max_size, double reps, double seed);
+RcppExport SEXP _natPsoho_nat_bench_kernels_cpp(SEXP n_varsSEXP, SEXP max_sizeSEXP, SEXP repsSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type n_vars(n_varsSEXP);
+    Rcpp::traits::input_parameter< int >::type max_size(max_sizeSEXP);
+    Rcpp::traits::input_parameter< double >::type reps(repsSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(nat_bench_kernels_cpp(n_vars, max_size, reps, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nat_write_columns_cpp
+void nat_write_columns_cpp(const Rcpp::List& dt, const Rcpp::StringVector& names, std::string file, bool append);
+RcppExport SEXP _natPsoho_nat_write_columns_cpp(SEXP dtSEXP, SEXP namesSEXP, SEXP fileSEXP, SEXP appendSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type dt(dtSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::StringVector& >::type names(namesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< bool >::type append(appendSEXP);
+    nat_write_columns_cpp(dt, names, file, append);
+    return R_NilValue;
+END_RCPP
+}
+// nat_columns_names_cpp
+Rcpp::StringVector nat_columns_names_cpp(std::string file);
+RcppExport SEXP _natPsoho_nat_columns_names_cpp(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(nat_columns_names_cpp(file));
+    return rcpp_result_gen;
+END_RCPP
+}
 // create_natcauslist_cpp
-Rcpp::NumericVector create_natcauslist_cpp(Rcpp::NumericVector& cl, Rcpp::List& net, StringVector& ordering);
-RcppExport SEXP _natPsoho_create_natcauslist_cpp(SEXP clSEXP, SEXP netSEXP, SEXP orderingSEXP) {
+Rcpp::NumericVector create_natcauslist_cpp(Rcpp::NumericVector& cl, Rcpp::List& net, StringVector& ordering, int max_size);
+RcppExport SEXP _natPsoho_create_natcauslist_cpp(SEXP clSEXP, SEXP netSEXP, SEXP orderingSEXP, SEXP max_sizeSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< Rcpp::NumericVector& >::type cl(clSEXP);
     Rcpp::traits::input_parameter< Rcpp::List& >::type net(netSEXP);
     Rcpp::traits::input_parameter< StringVector& >::type ordering(orderingSEXP);
-    rcpp_result_gen = Rcpp::wrap(create_natcauslist_cpp(cl, net, ordering));
+    Rcpp::traits::input_parameter< int >::type max_size(max_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_natcauslist_cpp(cl, net, ordering, max_size));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nat_nets_to_positions_cpp
+Rcpp::NumericMatrix nat_nets_to_positions_cpp(const Rcpp::List& nets, StringVector& ordering, int max_size);
+RcppExport SEXP _natPsoho_nat_nets_to_positions_cpp(SEXP netsSEXP, SEXP orderingSEXP, SEXP max_sizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type nets(netsSEXP);
+    Rcpp::traits::input_parameter< StringVector& >::type ordering(orderingSEXP);
+    Rcpp::traits::input_parameter< int >::type max_size(max_sizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(nat_nets_to_positions_cpp(nets, ordering, max_size));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -45,8 +97,178 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// nat_random_position_cpp
+Rcpp::NumericVector nat_random_position_cpp(int n_vars, int max_size, double p);
+RcppExport SEXP _natPsoho_nat_random_position_cpp(SEXP n_varsSEXP, SEXP max_sizeSEXP, SEXP pSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type n_vars(n_varsSEXP);
+    Rcpp::traits::input_parameter< int >::type max_size(max_sizeSEXP);
+    Rcpp::traits::input_parameter< double >::type p(pSEXP);
+    rcpp_result_gen = Rcpp::wrap(nat_random_position_cpp(n_vars, max_size, p));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nat_cap_parents_cpp
+int nat_cap_parents_cpp(Rcpp::NumericVector& cl, int max_parents, int n_arcs);
+RcppExport SEXP _natPsoho_nat_cap_parents_cpp(SEXP clSEXP, SEXP max_parentsSEXP, SEXP n_arcsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::NumericVector& >::type cl(clSEXP);
+    Rcpp::traits::input_parameter< int >::type max_parents(max_parentsSEXP);
+    Rcpp::traits::input_parameter< int >::type n_arcs(n_arcsSEXP);
+    rcpp_result_gen = Rcpp::wrap(nat_cap_parents_cpp(cl, max_parents, n_arcs));
+    return rcpp_result_gen;
+END_RCPP
+}
+// create_gaussian_scorer_cpp
+SEXP create_gaussian_scorer_cpp(const Rcpp::List& dt, const Rcpp::IntegerMatrix& col_idx, double iss_mu, double iss_w, double cache_size, std::string score);
+RcppExport SEXP _natPsoho_create_gaussian_scorer_cpp(SEXP dtSEXP, SEXP col_idxSEXP, SEXP iss_muSEXP, SEXP iss_wSEXP, SEXP cache_sizeSEXP, SEXP scoreSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type dt(dtSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerMatrix& >::type col_idx(col_idxSEXP);
+    Rcpp::traits::input_parameter< double >::type iss_mu(iss_muSEXP);
+    Rcpp::traits::input_parameter< double >::type iss_w(iss_wSEXP);
+    Rcpp::traits::input_parameter< double >::type cache_size(cache_sizeSEXP);
+    Rcpp::traits::input_parameter< std::string >::type score(scoreSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_gaussian_scorer_cpp(dt, col_idx, iss_mu, iss_w, cache_size, score));
+    return rcpp_result_gen;
+END_RCPP
+}
+// create_gaussian_scorer_raw_cpp
+SEXP create_gaussian_scorer_raw_cpp(const Rcpp::List& dt, const Rcpp::IntegerVector& var_idx, const Rcpp::IntegerVector& id, int max_size, double iss_mu, double iss_w, double cache_size, std::string score);
+RcppExport SEXP _natPsoho_create_gaussian_scorer_raw_cpp(SEXP dtSEXP, SEXP var_idxSEXP, SEXP idSEXP, SEXP max_sizeSEXP, SEXP iss_muSEXP, SEXP iss_wSEXP, SEXP cache_sizeSEXP, SEXP scoreSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type dt(dtSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type var_idx(var_idxSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type id(idSEXP);
+    Rcpp::traits::input_parameter< int >::type max_size(max_sizeSEXP);
+    Rcpp::traits::input_parameter< double >::type iss_mu(iss_muSEXP);
+    Rcpp::traits::input_parameter< double >::type iss_w(iss_wSEXP);
+    Rcpp::traits::input_parameter< double >::type cache_size(cache_sizeSEXP);
+    Rcpp::traits::input_parameter< std::string >::type score(scoreSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_gaussian_scorer_raw_cpp(dt, var_idx, id, max_size, iss_mu, iss_w, cache_size, score));
+    return rcpp_result_gen;
+END_RCPP
+}
+// create_gaussian_scorer_file_cpp
+SEXP create_gaussian_scorer_file_cpp(std::string file, const Rcpp::IntegerMatrix& col_idx, double iss_mu, double iss_w, double cache_size, int n_threads, std::string score);
+RcppExport SEXP _natPsoho_create_gaussian_scorer_file_cpp(SEXP fileSEXP, SEXP col_idxSEXP, SEXP iss_muSEXP, SEXP iss_wSEXP, SEXP cache_sizeSEXP, SEXP n_threadsSEXP, SEXP scoreSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerMatrix& >::type col_idx(col_idxSEXP);
+    Rcpp::traits::input_parameter< double >::type iss_mu(iss_muSEXP);
+    Rcpp::traits::input_parameter< double >::type iss_w(iss_wSEXP);
+    Rcpp::traits::input_parameter< double >::type cache_size(cache_sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type n_threads(n_threadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type score(scoreSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_gaussian_scorer_file_cpp(file, col_idx, iss_mu, iss_w, cache_size, n_threads, score));
+    return rcpp_result_gen;
+END_RCPP
+}
+// create_discrete_scorer_cpp
+SEXP create_discrete_scorer_cpp(const Rcpp::List& dt, const Rcpp::IntegerVector& levels, const Rcpp::IntegerMatrix& col_idx, double iss, double cache_size, double count_cache, std::string score);
+RcppExport SEXP _natPsoho_create_discrete_scorer_cpp(SEXP dtSEXP, SEXP levelsSEXP, SEXP col_idxSEXP, SEXP issSEXP, SEXP cache_sizeSEXP, SEXP count_cacheSEXP, SEXP scoreSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type dt(dtSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type levels(levelsSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerMatrix& >::type col_idx(col_idxSEXP);
+    Rcpp::traits::input_parameter< double >::type iss(issSEXP);
+    Rcpp::traits::input_parameter< double >::type cache_size(cache_sizeSEXP);
+    Rcpp::traits::input_parameter< double >::type count_cache(count_cacheSEXP);
+    Rcpp::traits::input_parameter< std::string >::type score(scoreSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_discrete_scorer_cpp(dt, levels, col_idx, iss, cache_size, count_cache, score));
+    return rcpp_result_gen;
+END_RCPP
+}
+// create_discrete_scorer_raw_cpp
+SEXP create_discrete_scorer_raw_cpp(const Rcpp::List& dt, const Rcpp::IntegerVector& var_idx, const Rcpp::IntegerVector& id, const Rcpp::IntegerVector& levels, int max_size, double iss, double cache_size, double count_cache, std::string score);
+RcppExport SEXP _natPsoho_create_discrete_scorer_raw_cpp(SEXP dtSEXP, SEXP var_idxSEXP, SEXP idSEXP, SEXP levelsSEXP, SEXP max_sizeSEXP, SEXP issSEXP, SEXP cache_sizeSEXP, SEXP count_cacheSEXP, SEXP scoreSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const Rcpp::List& >::type dt(dtSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type var_idx(var_idxSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type id(idSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::IntegerVector& >::type levels(levelsSEXP);
+    Rcpp::traits::input_parameter< int >::type max_size(max_sizeSEXP);
+    Rcpp::traits::input_parameter< double >::type iss(issSEXP);
+    Rcpp::traits::input_parameter< double >::type cache_size(cache_sizeSEXP);
+    Rcpp::traits::input_parameter< double >::type count_cache(count_cacheSEXP);
+    Rcpp::traits::input_parameter< std::string >::type score(scoreSEXP);
+    rcpp_result_gen = Rcpp::wrap(create_discrete_scorer_raw_cpp(dt, var_idx, id, levels, max_size, iss, cache_size, count_cache, score));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nat_score_cpp
+double nat_score_cpp(SEXP scorer, const Rcpp::NumericVector& cl);
+RcppExport SEXP _natPsoho_nat_score_cpp(SEXP scorerSEXP, SEXP clSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type scorer(scorerSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::NumericVector& >::type cl(clSEXP);
+    rcpp_result_gen = Rcpp::wrap(nat_score_cpp(scorer, cl));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nat_family_scores_cpp
+Rcpp::NumericVector nat_family_scores_cpp(SEXP scorer, const Rcpp::NumericVector& cl);
+RcppExport SEXP _natPsoho_nat_family_scores_cpp(SEXP scorerSEXP, SEXP clSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type scorer(scorerSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::NumericVector& >::type cl(clSEXP);
+    rcpp_result_gen = Rcpp::wrap(nat_family_scores_cpp(scorer, cl));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nat_cache_stats_cpp
+Rcpp::List nat_cache_stats_cpp(SEXP scorer);
+RcppExport SEXP _natPsoho_nat_cache_stats_cpp(SEXP scorerSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type scorer(scorerSEXP);
+    rcpp_result_gen = Rcpp::wrap(nat_cache_stats_cpp(scorer));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nat_open_score_store_cpp
+std::string nat_open_score_store_cpp(SEXP scorer, std::string dir);
+RcppExport SEXP _natPsoho_nat_open_score_store_cpp(SEXP scorerSEXP, SEXP dirSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type scorer(scorerSEXP);
+    Rcpp::traits::input_parameter< std::string >::type dir(dirSEXP);
+    rcpp_result_gen = Rcpp::wrap(nat_open_score_store_cpp(scorer, dir));
+    return rcpp_result_gen;
+END_RCPP
+}
+// nat_flush_score_store_cpp
+void nat_flush_score_store_cpp(SEXP scorer);
+RcppExport SEXP _natPsoho_nat_flush_score_store_cpp(SEXP scorerSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type scorer(scorerSEXP);
+    nat_flush_score_store_cpp(scorer);
+    return R_NilValue;
+END_RCPP
+}
 // one_hot_cpp
-int one_hot_cpp(int nat);
+double one_hot_cpp(int nat);
 RcppExport SEXP _natPsoho_one_hot_cpp(SEXP natSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
@@ -166,11 +388,44 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// nat_random_velocity_cpp
+int nat_random_velocity_cpp(Rcpp::NumericVector& vl, Rcpp::NumericVector& vl_neg, int max_size, const Rcpp::NumericVector& probs, double p);
+RcppExport SEXP _natPsoho_nat_random_velocity_cpp(SEXP vlSEXP, SEXP vl_negSEXP, SEXP max_sizeSEXP, SEXP probsSEXP, SEXP pSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::NumericVector& >::type vl(vlSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector& >::type vl_neg(vl_negSEXP);
+    Rcpp::traits::input_parameter< int >::type max_size(max_sizeSEXP);
+    Rcpp::traits::input_parameter< const Rcpp::NumericVector& >::type probs(probsSEXP);
+    Rcpp::traits::input_parameter< double >::type p(pSEXP);
+    rcpp_result_gen = Rcpp::wrap(nat_random_velocity_cpp(vl, vl_neg, max_size, probs, p));
+    return rcpp_result_gen;
+END_RCPP
+}
+
+RcppExport SEXP _rcpp_module_boot_nat_swarm_module();
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_natPsoho_create_natcauslist_cpp", (DL_FUNC) &_natPsoho_create_natcauslist_cpp, 3},
+    {"_natPsoho_nat_bench_kernels_cpp", (DL_FUNC) &_natPsoho_nat_bench_kernels_cpp, 4},
+    {"_natPsoho_nat_write_columns_cpp", (DL_FUNC) &_natPsoho_nat_write_columns_cpp, 4},
+    {"_natPsoho_nat_columns_names_cpp", (DL_FUNC) &_natPsoho_nat_columns_names_cpp, 1},
+    {"_natPsoho_create_natcauslist_cpp", (DL_FUNC) &_natPsoho_create_natcauslist_cpp, 4},
+    {"_natPsoho_nat_nets_to_positions_cpp", (DL_FUNC) &_natPsoho_nat_nets_to_positions_cpp, 3},
     {"_natPsoho_cl_to_arc_matrix_cpp", (DL_FUNC) &_natPsoho_cl_to_arc_matrix_cpp, 3},
     {"_natPsoho_nat_pos_plus_vel_cpp", (DL_FUNC) &_natPsoho_nat_pos_plus_vel_cpp, 4},
+    {"_natPsoho_nat_random_position_cpp", (DL_FUNC) &_natPsoho_nat_random_position_cpp, 3},
+    {"_natPsoho_nat_cap_parents_cpp", (DL_FUNC) &_natPsoho_nat_cap_parents_cpp, 3},
+    {"_natPsoho_create_gaussian_scorer_cpp", (DL_FUNC) &_natPsoho_create_gaussian_scorer_cpp, 6},
+    {"_natPsoho_create_gaussian_scorer_raw_cpp", (DL_FUNC) &_natPsoho_create_gaussian_scorer_raw_cpp, 8},
+    {"_natPsoho_create_gaussian_scorer_file_cpp", (DL_FUNC) &_natPsoho_create_gaussian_scorer_file_cpp, 7},
+    {"_natPsoho_create_discrete_scorer_cpp", (DL_FUNC) &_natPsoho_create_discrete_scorer_cpp, 7},
+    {"_natPsoho_create_discrete_scorer_raw_cpp", (DL_FUNC) &_natPsoho_create_discrete_scorer_raw_cpp, 9},
+    {"_natPsoho_nat_score_cpp", (DL_FUNC) &_natPsoho_nat_score_cpp, 2},
+    {"_natPsoho_nat_family_scores_cpp", (DL_FUNC) &_natPsoho_nat_family_scores_cpp, 2},
+    {"_natPsoho_nat_cache_stats_cpp", (DL_FUNC) &_natPsoho_nat_cache_stats_cpp, 1},
+    {"_natPsoho_nat_open_score_store_cpp", (DL_FUNC) &_natPsoho_nat_open_score_store_cpp, 2},
+    {"_natPsoho_nat_flush_score_store_cpp", (DL_FUNC) &_natPsoho_nat_flush_score_store_cpp, 1},
     {"_natPsoho_one_hot_cpp", (DL_FUNC) &_natPsoho_one_hot_cpp, 1},
     {"_natPsoho_bitcount", (DL_FUNC) &_natPsoho_bitcount, 1},
     {"_natPsoho_init_list_cpp", (DL_FUNC) &_natPsoho_init_list_cpp, 8},
@@ -180,6 +435,8 @@ static const R_CallMethodDef CallEntries[] = {
     {"_natPsoho_nat_pos_minus_pos_cpp", (DL_FUNC) &_natPsoho_nat_pos_minus_pos_cpp, 4},
     {"_natPsoho_nat_vel_plus_vel_cpp", (DL_FUNC) &_natPsoho_nat_vel_plus_vel_cpp, 6},
     {"_natPsoho_nat_cte_times_vel_cpp", (DL_FUNC) &_natPsoho_nat_cte_times_vel_cpp, 5},
+    {"_natPsoho_nat_random_velocity_cpp", (DL_FUNC) &_natPsoho_nat_random_velocity_cpp, 5},
+    {"_rcpp_module_boot_nat_swarm_module", (DL_FUNC) &_rcpp_module_boot_nat_swarm_module, 0},
     {NULL, NULL, 0}
 };
 
@@ -0,0 +1,41 @@
+#include "include/bench_r.h"
+
+//' Run the benchmarks of the native kernels
+//' 
+//' Runs the same benchmarks as the standalone program in bench/ plus the ones
+//' of the search of open bits in utils.cpp, which depend on Rcpp.
+//' 
+//' @param n_vars number of variables in t_0
+//' @param max_size maximum number of timeslices of the DBN
+//' @param reps number of calls to each kernel
+//' @param seed seed of the random causal lists
+//' @return a data.frame with the name of each benchmark, the network size, the number of calls and the mean time per call in nanoseconds
+// [[Rcpp::export]]
+Rcpp::DataFrame nat_bench_kernels_cpp(int n_vars, int max_size, double reps, double seed){
+  std::vector<natBenchResult> res = nat_bench_kernels(n_vars, max_size, (size_t)reps, (uint64_t)seed);
+  // These work on ints, so the causal units are capped to 30 bits
+  int max_int = (1 << std::min(max_size - 1, 30)) - 1;
+  int x = max_int / 3;
+  
+  res.push_back(natBenchResult{"find_open_bits", n_vars, max_size, (size_t)reps, nat_time_ns([&]{
+    nat_bench_sink = find_open_bits(x, true, max_int).size();
+  }, (size_t)reps)});
+  res.push_back(natBenchResult{"find_open_bits_log", n_vars, max_size, (size_t)reps, nat_time_ns([&]{
+    nat_bench_sink = find_open_bits_log(x, true, max_int).size();
+  }, (size_t)reps)});
+  
+  Rcpp::CharacterVector name(res.size());
+  Rcpp::IntegerVector vars(res.size()), size(res.size());
+  Rcpp::NumericVector n_reps(res.size()), ns(res.size());
+  for(size_t i = 0; i < res.size(); i++){
+    name[i] = res[i].name;
+    vars[i] = res[i].n_vars;
+    size[i] = res[i].max_size;
+    n_reps[i] = res[i].reps;
+    ns[i] = res[i].ns_per_op;
+  }
+  
+  return Rcpp::DataFrame::create(Rcpp::Named("name") = name, Rcpp::Named("n_vars") = vars,
+                                 Rcpp::Named("max_size") = size, Rcpp::Named("reps") = n_reps,
+                                 Rcpp::Named("ns_per_op") = ns, Rcpp::Named("stringsAsFactors") = false);
+}
@@ -1,23 +1,55 @@
 #include "include/causality_list.h"
 
-// Insert an arc in the correspondent temporal family. 
+// Build the index of the variables of an ordering. The names can have the
+// "_t_0" appended or not, and they have to be unique, as the size of the
+// index is the number of variables of the causal lists.
 // 
-// @param cl a causality list
 // @param ordering a list with the order of the variables in t_0
-// @param node the node to insert
-// @param i the causal unit in which to insert.
-void insert_node_natcl(Rcpp::NumericVector &cl, const StringVector &ordering, std::string node, unsigned int i){
-  Rcpp::StringVector tuple = find_name_and_index(node);
-  std::string tmp;
-  tmp = tuple[1];
-  int idx = std::stoi(tmp);
-  tmp = tuple[0];
-  int ordering_idx = find_index(ordering, tmp);
-  int arcs = cl[i * 3 + ordering_idx];
+// @return the map from the names of the variables to their position in the ordering
+natNameIndex nat_name_index(const StringVector &ordering){
+  natNameIndex res;
+  std::string name;
+  size_t pos;
+  
+  res.reserve(ordering.size());
+  for(int i = 0; i < ordering.size(); i++){
+    name = ordering[i];
+    pos = name.rfind("_t_0");
+    if(pos != std::string::npos && pos + 4 == name.size())
+      name.erase(pos);
+    res[name] = i;
+  }
+  if((int)res.size() != ordering.size())
+    Rcpp::stop("The names of the variables in the ordering are not unique.");
   
-  idx = one_hot_cpp(idx);
-  arcs = arcs | idx;
-  cl[i * 3 + ordering_idx] = arcs;
+  return res;
 }
 
-
+// Insert an arc in the correspondent temporal family. 
+// 
+// @param cl a causality list
+// @param index the index of the variables in t_0, see nat_name_index
+// @param node the parent node to insert, in the format 'name_t_slice'
+// @param i the index of the child node in t_0
+// @param max_size the maximum size of the network
+void insert_node_natcl(Rcpp::NumericVector &cl, const natNameIndex &index, const std::string &node, unsigned int i, int max_size){
+  size_t pos = node.rfind("_t_");
+  natNameIndex::const_iterator var;
+  int idx;
+  
+  if(pos == std::string::npos)
+    Rcpp::stop("The node " + node + " does not have the format 'name_t_slice'.");
+  var = index.find(node.substr(0, pos));
+  if(var == index.end())
+    Rcpp::stop("The node " + node + " is not in the ordering.");
+  idx = std::atoi(node.c_str() + pos + 3);
+  if(idx < 1)
+    Rcpp::stop("DBNs with intraslice arcs are not permitted.");
+  if(idx >= max_size)
+    Rcpp::stop("The node " + node + " is beyond the maximum size of the network.");
+  
+  uint64_t arcs = cl[i * index.size() + var->second];
+  
+  arcs = arcs | ((uint64_t)1 << (idx - 1));
+  cl[i * index.size() + var->second] = arcs;
+}
@@ -0,0 +1,47 @@
+#include "include/columnar_r.h"
+
+//' Write a dataset into a columnar binary file
+//' 
+//' The dataset is written as a single block of rows, either into a new file
+//' or appended to an existing one with the same columns.
+//' 
+//' @param dt a data.table or list with numeric columns
+//' @param names the names of the columns
+//' @param file path of the file
+//' @param append whether to append the rows to an existing file
+// [[Rcpp::export]]
+void nat_write_columns_cpp(const Rcpp::List &dt, const Rcpp::StringVector &names, std::string file, bool append){
+  natColumnWriter writer;
+  std::vector<Rcpp::NumericVector> cols(names.size());
+  std::vector<const double *> cols_ptr(names.size());
+  std::vector<std::string> col_names(names.size());
+  std::string err;
+  
+  for(int i = 0; i < names.size(); i++){
+    cols[i] = dt[i];
+    cols_ptr[i] = cols[i].begin();
+    col_names[i] = names[i];
+  }
+  
+  if(!writer.open(file, col_names, append, err))
+    Rcpp::stop(err);
+  if(names.size() > 0)
+    writer.write_block(cols_ptr, cols[0].size());
+  if(!writer.close())
+    Rcpp::stop("Error writing the file " + file + ".");
+}
+
+//' Get the names of the columns of a columnar binary file
+//' 
+//' @param file path of the file
+//' @return the names of the columns
+// [[Rcpp::export]]
+Rcpp::StringVector nat_columns_names_cpp(std::string file){
+  natColumnFile f;
+  std::string err;
+  
+  if(!f.open(file, err))
+    Rcpp::stop(err);
+  
+  return Rcpp::StringVector(f.get_names().begin(), f.get_names().end());
+}
@@ -0,0 +1,398 @@
+#ifndef nat_batch_kernels_op
+#define nat_batch_kernels_op
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include "words.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define NAT_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+// Batch kernels of the position and velocity algebra
+//
+// The algebra of the causal lists is purely bitwise and the number of arcs or
+// operations is a population count, so they do not depend on how the bits are
+// grouped into words. These kernels work on the raw bytes of a causal list of
+// any word type, which allows to process them with the widest vector
+// instructions of the machine. The AVX2 and AVX-512 versions are compiled with
+// target attributes and picked at runtime, falling back to a scalar version
+// over 64 bit words in any other case. Each kernel returns the change in the
+// number of arcs or operations caused by the update.
+
+// Scalar versions
+
+inline uint64_t nat_load64(const uint8_t *p){uint64_t x; std::memcpy(&x, p, 8); return x;}
+
+inline void nat_store64(uint8_t *p, uint64_t x){std::memcpy(p, &x, 8);}
+
+// Add a velocity to a position. Returns the change in the number of arcs and
+// writes in 'diff' the bits of each byte that were added or removed.
+inline int nat_bytes_pos_plus_vel_scalar(uint8_t *cl, const uint8_t *vl, const uint8_t *vl_neg, size_t n, uint8_t *diff){
+  int res = 0;
+  size_t i = 0;
+
+  for(; i + 8 <= n; i += 8){
+    uint64_t pos = nat_load64(cl + i);
+    uint64_t new_pos = (pos | nat_load64(vl + i)) & ~nat_load64(vl_neg + i);
+    res += nat_bitcount(new_pos) - nat_bitcount(pos);
+    nat_store64(diff + i, pos ^ new_pos);
+    nat_store64(cl + i, new_pos);
+  }
+  for(; i < n; i++){
+    uint8_t new_pos = (cl[i] | vl[i]) & ~vl_neg[i];
+    res += nat_bitcount(new_pos) - nat_bitcount(cl[i]);
+    diff[i] = cl[i] ^ new_pos;
+    cl[i] = new_pos;
+  }
+
+  return res;
+}
+
+// Whether any of the n bytes is not 0
+inline bool nat_bytes_any(const uint8_t *p, size_t n){
+  uint64_t acc = 0;
+  size_t i = 0;
+
+  for(; i + 8 <= n; i += 8)
+    acc |= nat_load64(p + i);
+  for(; i < n; i++)
+    acc |= p[i];
+
+  return acc != 0;
+}
+
+// Subtract two positions. Returns the number of operations of the velocity.
+inline int nat_bytes_pos_minus_pos_scalar(const uint8_t *ps1, const uint8_t *ps2, uint8_t *vl, uint8_t *vl_neg, size_t n){
+  int res = 0;
+  size_t i = 0;
+
+  for(; i + 8 <= n; i += 8){
+    uint64_t a = nat_load64(ps1 + i), b = nat_load64(ps2 + i);
+    nat_store64(vl + i, b & ~a);
+    nat_store64(vl_neg + i, a & ~b);
+    res += nat_bitcount(a ^ b);
+  }
+  for(; i < n; i++){
+    vl[i] = ps2[i] & ~ps1[i];
+    vl_neg[i] = ps1[i] & ~ps2[i];
+    res += nat_bitcount((uint8_t)(ps1[i] ^ ps2[i]));
+  }
+
+  return res;
+}
+
+// Add two velocities into the first one. Returns the change with respect to
+// the sum of the operations of both, which is always lesser or equal to 0.
+inline int nat_bytes_vel_plus_vel_scalar(uint8_t *vl1, uint8_t *vl1_neg, const uint8_t *vl2, const uint8_t *vl2_neg, size_t n){
+  int res = 0;
+  size_t i = 0;
+
+  for(; i + 8 <= n; i += 8){
+    uint64_t p1 = nat_load64(vl1 + i), p2 = nat_load64(vl2 + i);
+    uint64_t n1 = nat_load64(vl1_neg + i), n2 = nat_load64(vl2_neg + i);
+    res -= nat_bitcount(p1 & p2) + nat_bitcount(n1 & n2);
+    p1 |= p2;
+    n1 |= n2;
+    uint64_t mask = p1 & n1;
+    res -= 2 * nat_bitcount(mask);
+    nat_store64(vl1 + i, p1 ^ mask);
+    nat_store64(vl1_neg + i, n1 ^ mask);
+  }
+  for(; i < n; i++){
+    uint8_t p1 = vl1[i], p2 = vl2[i], n1 = vl1_neg[i], n2 = vl2_neg[i];
+    res -= nat_bitcount((uint8_t)(p1 & p2)) + nat_bitcount((uint8_t)(n1 & n2));
+    p1 |= p2;
+    n1 |= n2;
+    uint8_t mask = p1 & n1;
+    res -= 2 * nat_bitcount(mask);
+    vl1[i] = p1 ^ mask;
+    vl1_neg[i] = n1 ^ mask;
+  }
+
+  return res;
+}
+
+#ifdef NAT_X86_DISPATCH
+
+// AVX2 versions. There is no vector popcount, so bytes are counted with a
+// lookup table of nibbles and added with vpsadbw (Mula's algorithm).
+
+__attribute__((target("avx2")))
+inline __m256i nat_popcnt256(__m256i x){
+  const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                          0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0F);
+  __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(x, low)),
+                                _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+
+  return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2")))
+inline int nat_sum256(__m256i acc){
+  return (int)(_mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1) +
+               _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3));
+}
+
+__attribute__((target("avx2")))
+inline int nat_bytes_pos_plus_vel_avx2(uint8_t *cl, const uint8_t *vl, const uint8_t *vl_neg, size_t n, uint8_t *diff){
+  __m256i acc_new = _mm256_setzero_si256(), acc_old = _mm256_setzero_si256();
+  size_t i = 0;
+
+  for(; i + 32 <= n; i += 32){
+    __m256i pos = _mm256_loadu_si256((const __m256i *)(cl + i));
+    __m256i new_pos = _mm256_andnot_si256(_mm256_loadu_si256((const __m256i *)(vl_neg + i)),
+                                          _mm256_or_si256(pos, _mm256_loadu_si256((const __m256i *)(vl + i))));
+    acc_old = _mm256_add_epi64(acc_old, nat_popcnt256(pos));
+    acc_new = _mm256_add_epi64(acc_new, nat_popcnt256(new_pos));
+    _mm256_storeu_si256((__m256i *)(diff + i), _mm256_xor_si256(pos, new_pos));
+    _mm256_storeu_si256((__m256i *)(cl + i), new_pos);
+  }
+
+  return nat_sum256(acc_new) - nat_sum256(acc_old) + nat_bytes_pos_plus_vel_scalar(cl + i, vl + i, vl_neg + i, n - i, diff + i);
+}
+
+__attribute__((target("avx2")))
+inline int nat_bytes_pos_minus_pos_avx2(const uint8_t *ps1, const uint8_t *ps2, uint8_t *vl, uint8_t *vl_neg, size_t n){
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+
+  for(; i + 32 <= n; i += 32){
+    __m256i a = _mm256_loadu_si256((const __m256i *)(ps1 + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(ps2 + i));
+    _mm256_storeu_si256((__m256i *)(vl + i), _mm256_andnot_si256(a, b));
+    _mm256_storeu_si256((__m256i *)(vl_neg + i), _mm256_andnot_si256(b, a));
+    acc = _mm256_add_epi64(acc, nat_popcnt256(_mm256_xor_si256(a, b)));
+  }
+
+  return nat_sum256(acc) + nat_bytes_pos_minus_pos_scalar(ps1 + i, ps2 + i, vl + i, vl_neg + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline int nat_bytes_vel_plus_vel_avx2(uint8_t *vl1, uint8_t *vl1_neg, const uint8_t *vl2, const uint8_t *vl2_neg, size_t n){
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+
+  for(; i + 32 <= n; i += 32){
+    __m256i p1 = _mm256_loadu_si256((const __m256i *)(vl1 + i));
+    __m256i p2 = _mm256_loadu_si256((const __m256i *)(vl2 + i));
+    __m256i n1 = _mm256_loadu_si256((const __m256i *)(vl1_neg + i));
+    __m256i n2 = _mm256_loadu_si256((const __m256i *)(vl2_neg + i));
+    acc = _mm256_add_epi64(acc, nat_popcnt256(_mm256_and_si256(p1, p2)));
+    acc = _mm256_add_epi64(acc, nat_popcnt256(_mm256_and_si256(n1, n2)));
+    p1 = _mm256_or_si256(p1, p2);
+    n1 = _mm256_or_si256(n1, n2);
+    __m256i mask = _mm256_and_si256(p1, n1);
+    __m256i cnt = nat_popcnt256(mask);
+    acc = _mm256_add_epi64(acc, _mm256_add_epi64(cnt, cnt));
+    _mm256_storeu_si256((__m256i *)(vl1 + i), _mm256_xor_si256(p1, mask));
+    _mm256_storeu_si256((__m256i *)(vl1_neg + i), _mm256_xor_si256(n1, mask));
+  }
+
+  return -nat_sum256(acc) + nat_bytes_vel_plus_vel_scalar(vl1 + i, vl1_neg + i, vl2 + i, vl2_neg + i, n - i);
+}
+
+// AVX-512 versions, with the native 64 bit popcount of VPOPCNTDQ
+
+#define NAT_AVX512_TARGET __attribute__((target("avx512f,avx512bw,avx512vpopcntdq")))
+
+// ~a & b. The andnot intrinsic trips -Wmaybe-uninitialized in some versions of GCC.
+NAT_AVX512_TARGET
+inline __m512i nat_andnot512(__m512i a, __m512i b){
+  return _mm512_and_si512(_mm512_xor_si512(a, _mm512_set1_epi64(-1)), b);
+}
+
+NAT_AVX512_TARGET
+inline int nat_sum512(__m512i acc){
+  int64_t lanes[8];
+  _mm512_storeu_si512(lanes, acc);
+
+  return (int)(lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7]);
+}
+
+NAT_AVX512_TARGET
+inline int nat_bytes_pos_plus_vel_avx512(uint8_t *cl, const uint8_t *vl, const uint8_t *vl_neg, size_t n, uint8_t *diff){
+  __m512i acc = _mm512_setzero_si512();
+  size_t i = 0;
+
+  for(; i + 64 <= n; i += 64){
+    __m512i pos = _mm512_loadu_si512(cl + i);
+    __m512i new_pos = nat_andnot512(_mm512_loadu_si512(vl_neg + i),
+                                          _mm512_or_si512(pos, _mm512_loadu_si512(vl + i)));
+    acc = _mm512_add_epi64(acc, _mm512_sub_epi64(_mm512_popcnt_epi64(new_pos), _mm512_popcnt_epi64(pos)));
+    _mm512_storeu_si512(diff + i, _mm512_xor_si512(pos, new_pos));
+    _mm512_storeu_si512(cl + i, new_pos);
+  }
+
+  return nat_sum512(acc) + nat_bytes_pos_plus_vel_scalar(cl + i, vl + i, vl_neg + i, n - i, diff + i);
+}
+
+NAT_AVX512_TARGET
+inline int nat_bytes_pos_minus_pos_avx512(const uint8_t *ps1, const uint8_t *ps2, uint8_t *vl, uint8_t *vl_neg, size_t n){
+  __m512i acc = _mm512_setzero_si512();
+  size_t i = 0;
+
+  for(; i + 64 <= n; i += 64){
+    __m512i a = _mm512_loadu_si512(ps1 + i);
+    __m512i b = _mm512_loadu_si512(ps2 + i);
+    _mm512_storeu_si512(vl + i, nat_andnot512(a, b));
+    _mm512_storeu_si512(vl_neg + i, nat_andnot512(b, a));
+    acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_xor_si512(a, b)));
+  }
+
+  return nat_sum512(acc) + nat_bytes_pos_minus_pos_scalar(ps1 + i, ps2 + i, vl + i, vl_neg + i, n - i);
+}
+
+NAT_AVX512_TARGET
+inline int nat_bytes_vel_plus_vel_avx512(uint8_t *vl1, uint8_t *vl1_neg, const uint8_t *vl2, const uint8_t *vl2_neg, size_t n){
+  __m512i acc = _mm512_setzero_si512();
+  size_t i = 0;
+
+  for(; i + 64 <= n; i += 64){
+    __m512i p1 = _mm512_loadu_si512(vl1 + i);
+    __m512i p2 = _mm512_loadu_si512(vl2 + i);
+    __m512i n1 = _mm512_loadu_si512(vl1_neg + i);
+    __m512i n2 = _mm512_loadu_si512(vl2_neg + i);
+    acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_and_si512(p1, p2)));
+    acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_and_si512(n1, n2)));
+    p1 = _mm512_or_si512(p1, p2);
+    n1 = _mm512_or_si512(n1, n2);
+    __m512i mask = _mm512_and_si512(p1, n1);
+    __m512i cnt = _mm512_popcnt_epi64(mask);
+    acc = _mm512_add_epi64(acc, _mm512_add_epi64(cnt, cnt));
+    _mm512_storeu_si512(vl1 + i, _mm512_xor_si512(p1, mask));
+    _mm512_storeu_si512(vl1_neg + i, _mm512_xor_si512(n1, mask));
+  }
+
+  return -nat_sum512(acc) + nat_bytes_vel_plus_vel_scalar(vl1 + i, vl1_neg + i, vl2 + i, vl2_neg + i, n - i);
+}
+
+#endif
+
+// Instruction sets of the batch kernels
+enum natIsa {NAT_ISA_SCALAR = 0, NAT_ISA_AVX2 = 1, NAT_ISA_AVX512 = 2};
+
+// Table with the batch kernels of one instruction set
+struct natBatchKernels {
+  int (*pos_plus_vel)(uint8_t *, const uint8_t *, const uint8_t *, size_t, uint8_t *);
+  int (*pos_minus_pos)(const uint8_t *, const uint8_t *, uint8_t *, uint8_t *, size_t);
+  int (*vel_plus_vel)(uint8_t *, uint8_t *, const uint8_t *, const uint8_t *, size_t);
+  natIsa isa;
+};
+
+// Best instruction set supported by the machine
+inline natIsa nat_detect_isa(){
+#ifdef NAT_X86_DISPATCH
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+     __builtin_cpu_supports("avx512vpopcntdq"))
+    return NAT_ISA_AVX512;
+  if(__builtin_cpu_supports("avx2"))
+    return NAT_ISA_AVX2;
+#endif
+  return NAT_ISA_SCALAR;
+}
+
+// Kernels of an instruction set. If the machine does not support it, the best
+// one below it is used instead.
+inline natBatchKernels nat_batch_kernels_for(natIsa isa){
+  static const natIsa best = nat_detect_isa();
+  natBatchKernels res = {nat_bytes_pos_plus_vel_scalar, nat_bytes_pos_minus_pos_scalar,
+                         nat_bytes_vel_plus_vel_scalar, NAT_ISA_SCALAR};
+
+  if(isa > best)
+    isa = best;
+#ifdef NAT_X86_DISPATCH
+  if(isa == NAT_ISA_AVX512){
+    res.pos_plus_vel = nat_bytes_pos_plus_vel_avx512;
+    res.pos_minus_pos = nat_bytes_pos_minus_pos_avx512;
+    res.vel_plus_vel = nat_bytes_vel_plus_vel_avx512;
+    res.isa = NAT_ISA_AVX512;
+  }
+  else if(isa == NAT_ISA_AVX2){
+    res.pos_plus_vel = nat_bytes_pos_plus_vel_avx2;
+    res.pos_minus_pos = nat_bytes_pos_minus_pos_avx2;
+    res.vel_plus_vel = nat_bytes_vel_plus_vel_avx2;
+    res.isa = NAT_ISA_AVX2;
+  }
+#endif
+
+  return res;
+}
+
+inline const char* nat_isa_name(natIsa isa){
+  switch(isa){
+  case NAT_ISA_AVX512: return "avx512";
+  case NAT_ISA_AVX2: return "avx2";
+  default: return "scalar";
+  }
+}
+
+// Number of 64 bit words of the bitmap of dirty nodes of a particle
+inline size_t nat_dirty_words(int n_vars){return (n_vars + 63) / 64;}
+
+// Swarm wide batch kernels
+//
+// The causal lists of the particles are stored one after the other in an
+// arena, so the particle i owns [i * len, (i + 1) * len). These process the
+// particles in [first, last) in one pass and update their counters in place.
+
+// Add the velocities of the particles to their positions. Each row of n_vars
+// causal units holds the parents of one node, and the nodes whose parents
+// change are marked as dirty. The kernel runs once over the whole causal list
+// of each particle, and the changed rows are found afterwards in the bits
+// that it flipped.
+//
+// @param n_vars number of nodes, the rows of each causal list
+// @param n_arcs the number of arcs of each particle, updated in place
+// @param dirty bitmap of dirty nodes of each particle, nat_dirty_words(n_vars)
+// words per particle. The bits of the changed nodes are set, the rest are kept.
+// @param diff scratch of len * sizeof(W) bytes for the flipped bits, owned by
+// the caller so that it is not allocated on every call
+template <typename W>
+void nat_batch_pos_plus_vel(const natBatchKernels &k, W *cl, const W *vl, const W *vl_neg, size_t len,
+                            int n_vars, int first, int last, int *n_arcs, uint64_t *dirty, uint8_t *diff){
+  size_t row = n_vars * sizeof(W), words = nat_dirty_words(n_vars);
+
+  for(int i = first; i < last; i++){
+    n_arcs[i] += k.pos_plus_vel((uint8_t *)(cl + i * len), (const uint8_t *)(vl + i * len),
+                                (const uint8_t *)(vl_neg + i * len), len * sizeof(W), diff);
+    for(int j = 0; j < n_vars; j++)
+      if(nat_bytes_any(diff + j * row, row))
+        dirty[i * words + j / 64] |= 1ULL << (j % 64);
+  }
+}
+
+// Velocities that take the positions of the particles to their targets
+//
+// @param target the arena of the targets. A stride of 0 means that all the
+// particles share the same target, len that each one has its own.
+// @param abs_op the number of operations of each velocity, set in place
+template <typename W>
+void nat_batch_pos_minus_pos(const natBatchKernels &k, const W *ps, const W *target, size_t stride,
+                             W *vl, W *vl_neg, size_t len, int first, int last, int *abs_op){
+  size_t bytes = len * sizeof(W);
+
+  for(int i = first; i < last; i++)
+    abs_op[i] = k.pos_minus_pos((const uint8_t *)(ps + i * len), (const uint8_t *)(target + i * stride),
+                                (uint8_t *)(vl + i * len), (uint8_t *)(vl_neg + i * len), bytes);
+}
+
+// Add the second velocities of the particles to the first ones
+//
+// @param abs_op1 the number of operations of the first velocities, updated in place
+// @param abs_op2 the number of operations of the second velocities
+template <typename W>
+void nat_batch_vel_plus_vel(const natBatchKernels &k, W *vl1, W *vl1_neg, const W *vl2, const W *vl2_neg,
+                            size_t len, int first, int last, int *abs_op1, const int *abs_op2){
+  size_t bytes = len * sizeof(W);
+
+  for(int i = first; i < last; i++)
+    abs_op1[i] += abs_op2[i] + k.vel_plus_vel((uint8_t *)(vl1 + i * len), (uint8_t *)(vl1_neg + i * len),
+                                              (const uint8_t *)(vl2 + i * len), (const uint8_t *)(vl2_neg + i * len), bytes);
+}
+
+#endif
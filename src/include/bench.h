@@ -0,0 +1,218 @@
+#ifndef nat_bench_op
+#define nat_bench_op
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+#include "kernels.h"
+#include "batch_kernels.h"
+#include "rng.h"
+#include "swarm.h"
+
+// Benchmarks of the native kernels
+//
+// Shared by the standalone benchmark in bench/ and by nat_bench_kernels_cpp,
+// so both measure exactly the same code. Every benchmark runs a kernel on
+// random causal lists of a network of n_vars variables and max_size time
+// slices and reports the mean time per call.
+
+// Result of a benchmark
+struct natBenchResult {
+  std::string name;
+  int n_vars, max_size;
+  size_t reps;
+  double ns_per_op;
+};
+
+// Keeps the results of the kernels alive so the compiler cannot drop them
+static volatile double nat_bench_sink;
+
+// Mean time in nanoseconds of reps calls to f
+template <class F>
+double nat_time_ns(F f, size_t reps){
+  auto start = std::chrono::steady_clock::now();
+
+  for(size_t r = 0; r < reps; r++)
+    f();
+
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / reps;
+}
+
+// Gaussian dataset of n_rows rows of a network folded into max_size time
+// slices, where each variable depends on itself in the previous instant
+inline std::shared_ptr<natSuffStats> nat_bench_stats(int n_vars, int max_size, size_t n_rows, natCounterRng &rng){
+  std::vector<std::vector<double>> series(n_vars, std::vector<double>(n_rows + max_size));
+  std::vector<const double *> ptrs(n_vars);
+  std::shared_ptr<natSuffStats> res = std::make_shared<natSuffStats>(n_vars * max_size);
+
+  for(int j = 0; j < n_vars; j++){
+    for(size_t r = 0; r < series[j].size(); r++){
+      // Box-Muller
+      double z = std::sqrt(-2 * std::log(1 - rng.unif01())) * std::cos(2 * std::acos(-1.0) * rng.unif01());
+      series[j][r] = z + (r > 0 ? 0.5 * series[j][r - 1] : 0);
+    }
+    ptrs[j] = series[j].data();
+  }
+  res->add_series(ptrs, series[0].size(), max_size);
+
+  return res;
+}
+
+// Discrete dataset with the same structure as nat_bench_stats, where each
+// variable has 3 levels and keeps its level of the previous instant half of the time
+inline std::shared_ptr<natCodedData> nat_bench_coded(int n_vars, int max_size, size_t n_rows, natCounterRng &rng){
+  std::vector<std::vector<int>> series(n_vars, std::vector<int>(n_rows + max_size));
+  std::vector<const int *> ptrs(n_vars);
+  std::shared_ptr<natCodedData> res = std::make_shared<natCodedData>(std::vector<int>(n_vars * max_size, 3));
+
+  for(int j = 0; j < n_vars; j++){
+    for(size_t r = 0; r < series[j].size(); r++)
+      series[j][r] = r > 0 && rng.unif01() < 0.5 ? series[j][r - 1] : rng.index(3);
+    ptrs[j] = series[j].data();
+  }
+  res->add_series(ptrs, series[0].size(), max_size);
+
+  return res;
+}
+
+// Run the benchmarks of the kernels for a network size
+//
+// @param n_vars number of variables in t_0
+// @param max_size maximum number of timeslices of the DBN
+// @param reps number of calls to each kernel. The swarm and scorer benchmarks,
+// which are much slower, run reps / 100 times
+// @param seed seed of the random causal lists
+// @return the results of the benchmarks
+inline std::vector<natBenchResult> nat_bench_kernels(int n_vars, int max_size, size_t reps, uint64_t seed = 0){
+  std::vector<natBenchResult> res;
+  natCounterRng rng(seed);
+  size_t len = (size_t)n_vars * n_vars;
+  size_t slow_reps = reps / 100 > 0 ? reps / 100 : 1;
+  double probs[3] = {10, 65, 25};
+  std::vector<double> ps1(len), ps2(len), vl(len), vl_neg(len), vl2(len), vl2_neg(len);
+  natOpPool pool;
+  int n_arcs, abs_op;
+
+  auto add = [&](const std::string &name, size_t r, double ns){
+    res.push_back(natBenchResult{name, n_vars, max_size, r, ns});
+  };
+
+  n_arcs = nat_random_position(ps1.data(), len, max_size, 0.06, rng);
+  nat_random_position(ps2.data(), len, max_size, 0.06, rng);
+  abs_op = nat_random_velocity(vl.data(), vl_neg.data(), len, max_size, probs, 0.06, rng);
+  int abs_op2 = nat_random_velocity(vl2.data(), vl2_neg.data(), len, max_size, probs, 0.06, rng);
+
+  // Kernels behind position.cpp and velocity.cpp, on the doubles of R
+  add("random_position", reps, nat_time_ns([&]{
+    nat_bench_sink = nat_random_position(ps2.data(), len, max_size, 0.06, rng);
+  }, reps));
+  add("random_velocity", reps, nat_time_ns([&]{
+    nat_bench_sink = nat_random_velocity(vl2.data(), vl2_neg.data(), len, max_size, probs, 0.06, rng);
+  }, reps));
+  add("pos_plus_vel", reps, nat_time_ns([&]{
+    n_arcs = nat_pos_plus_vel(ps1.data(), vl.data(), vl_neg.data(), len, n_arcs);
+  }, reps));
+  add("pos_minus_pos", reps, nat_time_ns([&]{
+    nat_bench_sink = nat_pos_minus_pos(ps1.data(), ps2.data(), vl2.data(), vl2_neg.data(), len);
+  }, reps));
+  add("vel_plus_vel", reps, nat_time_ns([&]{
+    std::vector<double> v(vl), v_neg(vl_neg);
+    nat_bench_sink = nat_vel_plus_vel(v.data(), v_neg.data(), vl2.data(), vl2_neg.data(), len, abs_op, abs_op2);
+  }, reps));
+  add("cte_times_vel", reps, nat_time_ns([&]{
+    std::vector<double> v(vl), v_neg(vl_neg);
+    nat_bench_sink = nat_cte_times_vel(0.7f, v.data(), v_neg.data(), len, abs_op, max_size, rng, pool);
+  }, reps));
+  // Kernel behind the search of open bits of utils.cpp
+  add("select_bit", reps, nat_time_ns([&]{
+    uint64_t x = nat_to_word<uint64_t>(ps1[rng.index(len)]) | 1;
+    nat_bench_sink = nat_select_bit(x, rng.index(nat_bitcount(x)));
+  }, reps));
+
+  // Batch kernels over the bytes of the causal lists of 64 particles, with
+  // each instruction set available
+  std::vector<uint8_t> b_ps(64 * len), b_vl(64 * len), b_vl_neg(64 * len), b_vl2(64 * len), b_vl2_neg(64 * len);
+  std::vector<uint8_t> b_diff(64 * len);
+  for(size_t i = 0; i < b_ps.size(); i++){
+    b_ps[i] = rng.index(256);
+    b_vl[i] = rng.index(256) & rng.index(256);
+    b_vl_neg[i] = rng.index(256) & ~b_vl[i];
+    b_vl2[i] = rng.index(256) & rng.index(256);
+    b_vl2_neg[i] = rng.index(256) & ~b_vl2[i];
+  }
+  for(int isa = NAT_ISA_SCALAR; isa <= NAT_ISA_AVX512; isa++){
+    natBatchKernels k = nat_batch_kernels_for((natIsa)isa);
+    if(k.isa != isa)
+      continue;
+    add(std::string("batch_pos_plus_vel_") + nat_isa_name(k.isa), reps, nat_time_ns([&]{
+      nat_bench_sink = k.pos_plus_vel(b_ps.data(), b_vl.data(), b_vl_neg.data(), b_ps.size(), b_diff.data());
+    }, reps));
+    add(std::string("batch_vel_plus_vel_") + nat_isa_name(k.isa), reps, nat_time_ns([&]{
+      nat_bench_sink = k.vel_plus_vel(b_vl.data(), b_vl_neg.data(), b_vl2.data(), b_vl2_neg.data(), b_ps.size());
+    }, reps));
+  }
+
+  // Scorer and swarm on a random dataset
+  natBgeScore scorer(natBgePolicy(nat_bench_stats(n_vars, max_size, 1000, rng), n_vars * max_size, n_vars,
+                                  max_size, 1, n_vars * max_size + 2), 0);
+  add("bge_score", slow_reps, nat_time_ns([&]{
+    nat_bench_sink = scorer.score(ps1.data());
+  }, slow_reps));
+  // Without the cache of parent configurations, every family is counted
+  natDiscreteScore discrete(natDiscretePolicy(nat_bench_coded(n_vars, max_size, 1000, rng), n_vars, max_size,
+                                              NAT_DISCRETE_BDE, 1, 0), 0);
+  add("bde_score", slow_reps, nat_time_ns([&]{
+    nat_bench_sink = discrete.score(ps1.data());
+  }, slow_reps));
+
+  natPsoParams params = {1, 0.5, 0.5, -0.5, 1.5, true, 0, 0, 0, 0, NAT_PRUNE_SCORE};
+  std::unique_ptr<natSwarmBase> swarm(nat_create_swarm(&scorer, 20, max_size, params, 1));
+  if(swarm){
+    swarm->seed(seed);
+    add("swarm_randomize", slow_reps, nat_time_ns([&]{swarm->randomize(probs, 0.06);}, slow_reps));
+  }
+  if(swarm && max_size <= 54){
+    for(int i = 0; i < 20; i++){
+      n_arcs = nat_random_position(ps2.data(), len, max_size, 0.06, rng);
+      abs_op = nat_random_velocity(vl2.data(), vl2_neg.data(), len, max_size, probs, 0.06, rng);
+      swarm->set_particle(i, ps2.data(), vl2.data(), vl2_neg.data(), abs_op);
+    }
+    swarm->seed(seed);
+    swarm->evaluate();
+    add("swarm_step", slow_reps, nat_time_ns([&]{swarm->step();}, slow_reps));
+  }
+
+  return res;
+}
+
+// Results as CSV, with a header
+inline std::string nat_bench_csv(const std::vector<natBenchResult> &res){
+  std::ostringstream out;
+
+  out << "name,n_vars,max_size,reps,ns_per_op\n";
+  for(const natBenchResult &r : res)
+    out << r.name << "," << r.n_vars << "," << r.max_size << "," << r.reps << "," << r.ns_per_op << "\n";
+
+  return out.str();
+}
+
+// Results as a JSON array of objects
+inline std::string nat_bench_json(const std::vector<natBenchResult> &res){
+  std::ostringstream out;
+
+  out << "[";
+  for(size_t i = 0; i < res.size(); i++){
+    out << (i ? ",\n " : "\n ") << "{\"name\": \"" << res[i].name << "\", \"n_vars\": " << res[i].n_vars
+        << ", \"max_size\": " << res[i].max_size << ", \"reps\": " << res[i].reps
+        << ", \"ns_per_op\": " << res[i].ns_per_op << "}";
+  }
+  out << "\n]\n";
+
+  return out.str();
+}
+
+#endif
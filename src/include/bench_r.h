@@ -0,0 +1,13 @@
+#ifndef Rcpp_head
+#define Rcpp_head
+#include <Rcpp.h>
+using namespace Rcpp;
+#endif
+
+#include "utils.h"
+#include "bench.h"
+
+#ifndef nat_bench_r_op
+#define nat_bench_r_op
+Rcpp::DataFrame nat_bench_kernels_cpp(int n_vars, int max_size, double reps, double seed);
+#endif
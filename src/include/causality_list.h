@@ -4,9 +4,15 @@
 using namespace Rcpp;
 #endif
 
+#include <string>
+#include <unordered_map>
 #include "utils.h"
 
 #ifndef nat_cl_op
 #define nat_cl_op
-void insert_node_natcl(Rcpp::NumericVector &cl, const StringVector &ordering, std::string node, unsigned int i);
-#endif
\ No newline at end of file
+// Index of each variable in t_0 by its name without the appended "_t_0"
+typedef std::unordered_map<std::string, int> natNameIndex;
+
+natNameIndex nat_name_index(const StringVector &ordering);
+void insert_node_natcl(Rcpp::NumericVector &cl, const natNameIndex &index, const std::string &node, unsigned int i, int max_size);
+#endif
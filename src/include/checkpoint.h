@@ -0,0 +1,164 @@
+#ifndef nat_checkpoint_op
+#define nat_checkpoint_op
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// Binary checkpoints of the swarms
+//
+// A checkpoint is the magic "NATCKPT1" followed by the state of a swarm as
+// the swarm writes it: plain values and arrays copied as they are in memory,
+// each array preceded by its length as an uint64. The arrays are written with
+// a single call each, so a checkpoint costs about as much as copying the
+// state of the swarm once. Checkpoints are only meant to be read back on the
+// same machine and build of the package.
+//
+// The file is first written under a temporary name, synced to disk and then
+// renamed over the previous checkpoint, so a run stopped or a system crashed
+// while writing a checkpoint keeps the previous one.
+
+const char NAT_CKPT_MAGIC[8] = {'N', 'A', 'T', 'C', 'K', 'P', 'T', '1'};
+
+// Writer of checkpoints. Errors are reported with the return value, as the
+// checkpoints are written from R.
+class natCheckpointOut {
+public:
+  // @param path path of the checkpoint
+  // @param err the message of the error, if any
+  // @return whether the temporary file was created
+  bool open(const std::string &path, std::string &err){
+    this->path = path;
+    tmp_path = path + ".tmp";
+    f = std::fopen(tmp_path.c_str(), "wb");
+    if(!f){
+      err = "Cannot create the file " + tmp_path + ".";
+      return false;
+    }
+    std::fwrite(NAT_CKPT_MAGIC, 1, 8, f);
+
+    return true;
+  }
+
+  template <typename T>
+  void put(const T &x){
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+    std::fwrite(&x, sizeof(T), 1, f);
+  }
+
+  template <typename T>
+  void put(const std::vector<T> &x){
+    static_assert(std::is_trivially_copyable<T>::value, "Only arrays of plain values can be written");
+    uint64_t n = x.size();
+    std::fwrite(&n, sizeof(uint64_t), 1, f);
+    std::fwrite(x.data(), sizeof(T), n, f);
+  }
+
+  // Close the temporary file and move it to its final path
+  //
+  // @param err the message of the error, if any
+  // @return whether the checkpoint was written
+  bool close(std::string &err){
+    bool ok = std::fflush(f) == 0 && !std::ferror(f);
+
+#ifndef _WIN32
+    ok = ok && fsync(fileno(f)) == 0;
+#endif
+    ok = std::fclose(f) == 0 && ok;
+    f = nullptr;
+    if(ok){
+#ifdef _WIN32
+      // rename does not overwrite on Windows
+      ok = MoveFileExA(tmp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+      ok = std::rename(tmp_path.c_str(), path.c_str()) == 0;
+#endif
+    }
+    if(!ok)
+      err = "Cannot write the checkpoint " + path + ".";
+
+    return ok;
+  }
+
+  ~natCheckpointOut(){
+    if(f)
+      std::fclose(f);
+  }
+
+private:
+  std::FILE *f = nullptr;
+  std::string path, tmp_path;
+};
+
+// Reader of checkpoints. Reading past the end of the file or an array of a
+// different length than expected sets the state as failed, which is checked
+// once at the end.
+class natCheckpointIn {
+public:
+  // @param path path of the checkpoint
+  // @param err the message of the error, if any
+  // @return whether the file is a checkpoint
+  bool open(const std::string &path, std::string &err){
+    char magic[8];
+
+    f = std::fopen(path.c_str(), "rb");
+    if(!f){
+      err = "Cannot open the file " + path + ".";
+      return false;
+    }
+    if(std::fread(magic, 1, 8, f) != 8 || std::memcmp(magic, NAT_CKPT_MAGIC, 8) != 0){
+      err = "The file " + path + " is not a checkpoint.";
+      return false;
+    }
+
+    return true;
+  }
+
+  template <typename T>
+  void get(T &x){
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read");
+    ok = ok && std::fread(&x, sizeof(T), 1, f) == 1;
+  }
+
+  // Read an array. If 'size' is not 0, the array has to have that length.
+  template <typename T>
+  void get(std::vector<T> &x, uint64_t size = 0){
+    static_assert(std::is_trivially_copyable<T>::value, "Only arrays of plain values can be read");
+    uint64_t n = 0;
+
+    get(n);
+    ok = ok && (size == 0 || n == size);
+    if(!ok)
+      return;
+    x.resize(n);
+    ok = std::fread(x.data(), sizeof(T), n, f) == n;
+  }
+
+  // Mark the checkpoint as not matching what is being read
+  void fail(){ok = false;}
+
+  bool good() const {return ok;}
+
+  ~natCheckpointIn(){
+    if(f)
+      std::fclose(f);
+  }
+
+private:
+  std::FILE *f = nullptr;
+  bool ok = true;
+};
+
+#endif
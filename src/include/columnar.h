@@ -0,0 +1,366 @@
+#ifndef nat_columnar_op
+#define nat_columnar_op
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <algorithm>
+#include "suff_stats.h"
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Columnar binary datasets
+//
+// A file holds a header followed by blocks of rows. Every block stores its
+// columns one after the other as native doubles, so each column of a block
+// can be read in place from the mapped file as a plain array. New blocks can
+// be appended without rewriting the file, which allows to write datasets
+// larger than the memory in chunks.
+//
+// Layout, with all integers in the byte order of the machine:
+//   magic "NATCOL1" plus a 0 byte
+//   uint32 number of columns, uint32 0
+//   uint64 total number of rows
+//   uint64 number of blocks
+//   per column: uint32 length of the name followed by its characters
+//   padding up to a multiple of 8 bytes
+//   per block: uint64 number of rows, then the columns of the block
+
+const char NAT_COL_MAGIC[8] = {'N', 'A', 'T', 'C', 'O', 'L', '1', '\0'};
+const size_t NAT_COL_ROWS_OFFSET = 16;
+
+// Writer of columnar files. Errors are reported with the return value and the
+// 'err' argument, as the files are written from R.
+class natColumnWriter {
+public:
+  // Create a new file or open an existing one to append blocks to it
+  //
+  // @param path path of the file
+  // @param names the names of the columns. When appending, they have to be
+  // the same ones as in the file.
+  // @param append whether to append to an existing file
+  // @param err the message of the error, if any
+  // @return whether the file was opened
+  bool open(const std::string &path, const std::vector<std::string> &names, bool append, std::string &err){
+    n_cols = names.size();
+    n_rows = n_blocks = 0;
+
+    if(append){
+      f = std::fopen(path.c_str(), "r+b");
+      if(!f){
+        err = "Cannot open the file " + path + " to append to it.";
+        return false;
+      }
+      if(!read_header(names, err)){
+        close();
+        return false;
+      }
+      std::fseek(f, 0, SEEK_END);
+    }
+    else{
+      f = std::fopen(path.c_str(), "wb");
+      if(!f){
+        err = "Cannot create the file " + path + ".";
+        return false;
+      }
+      write_header(names);
+    }
+
+    return true;
+  }
+
+  // Append a block of rows
+  //
+  // @param cols pointers to the first row of the block in each column
+  // @param rows number of rows of the block
+  void write_block(const std::vector<const double *> &cols, uint64_t rows){
+    std::fwrite(&rows, sizeof(uint64_t), 1, f);
+    for(uint32_t c = 0; c < n_cols; c++)
+      std::fwrite(cols[c], sizeof(double), rows, f);
+    n_rows += rows;
+    n_blocks++;
+  }
+
+  // Update the counts in the header and close the file
+  //
+  // @return whether everything was written
+  bool close(){
+    bool ok = true;
+
+    if(f){
+      std::fseek(f, NAT_COL_ROWS_OFFSET, SEEK_SET);
+      std::fwrite(&n_rows, sizeof(uint64_t), 1, f);
+      std::fwrite(&n_blocks, sizeof(uint64_t), 1, f);
+      ok = !std::ferror(f);
+      ok = std::fclose(f) == 0 && ok;
+      f = nullptr;
+    }
+
+    return ok;
+  }
+
+  ~natColumnWriter(){close();}
+
+private:
+  std::FILE *f = nullptr;
+  uint32_t n_cols;
+  uint64_t n_rows, n_blocks;
+
+  void write_header(const std::vector<std::string> &names){
+    uint32_t zero = 0, len;
+    size_t size = 32;
+    char pad[8] = {0};
+
+    std::fwrite(NAT_COL_MAGIC, 1, 8, f);
+    std::fwrite(&n_cols, sizeof(uint32_t), 1, f);
+    std::fwrite(&zero, sizeof(uint32_t), 1, f);
+    std::fwrite(&n_rows, sizeof(uint64_t), 1, f);
+    std::fwrite(&n_blocks, sizeof(uint64_t), 1, f);
+    for(const std::string &name : names){
+      len = name.size();
+      std::fwrite(&len, sizeof(uint32_t), 1, f);
+      std::fwrite(name.data(), 1, len, f);
+      size += 4 + len;
+    }
+    std::fwrite(pad, 1, (8 - size % 8) % 8, f);
+  }
+
+  bool read_header(const std::vector<std::string> &names, std::string &err){
+    char magic[8];
+    uint32_t file_cols, zero, len;
+    std::string name;
+
+    if(std::fread(magic, 1, 8, f) != 8 || std::memcmp(magic, NAT_COL_MAGIC, 8) != 0 ||
+       std::fread(&file_cols, sizeof(uint32_t), 1, f) != 1 || std::fread(&zero, sizeof(uint32_t), 1, f) != 1 ||
+       std::fread(&n_rows, sizeof(uint64_t), 1, f) != 1 || std::fread(&n_blocks, sizeof(uint64_t), 1, f) != 1){
+      err = "The file is not a columnar dataset.";
+      return false;
+    }
+    if(file_cols != n_cols){
+      err = "The columns do not match the ones in the file.";
+      return false;
+    }
+    for(uint32_t c = 0; c < n_cols; c++){
+      if(std::fread(&len, sizeof(uint32_t), 1, f) != 1){
+        err = "The file is not a columnar dataset.";
+        return false;
+      }
+      name.resize(len);
+      if(std::fread(&name[0], 1, len, f) != len || name != names[c]){
+        err = "The columns do not match the ones in the file.";
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+// Read only view of a columnar file mapped in memory. The pages of the file
+// are loaded by the operating system as they are read and can be dropped
+// again, so the memory used does not depend on the size of the dataset.
+class natColumnFile {
+public:
+  natColumnFile(){}
+  natColumnFile(const natColumnFile &) = delete;
+  natColumnFile& operator=(const natColumnFile &) = delete;
+
+  ~natColumnFile(){unmap();}
+
+  // Map a file and index its blocks
+  //
+  // @param path path of the file
+  // @param err the message of the error, if any
+  // @return whether the file was mapped
+  bool open(const std::string &path, std::string &err){
+    size_t pos = 32;
+    uint32_t len;
+    uint64_t n_blocks, rows;
+
+    if(!map(path)){
+      err = "Cannot map the file " + path + ".";
+      return false;
+    }
+    if(size < 32 || std::memcmp(data, NAT_COL_MAGIC, 8) != 0){
+      err = "The file " + path + " is not a columnar dataset.";
+      return false;
+    }
+    std::memcpy(&n_cols, data + 8, sizeof(uint32_t));
+    std::memcpy(&n_rows, data + NAT_COL_ROWS_OFFSET, sizeof(uint64_t));
+    std::memcpy(&n_blocks, data + NAT_COL_ROWS_OFFSET + 8, sizeof(uint64_t));
+
+    names.resize(n_cols);
+    for(uint32_t c = 0; c < n_cols; c++){
+      if(pos + 4 > size)
+        return truncated(path, err);
+      std::memcpy(&len, data + pos, sizeof(uint32_t));
+      if(pos + 4 + len > size)
+        return truncated(path, err);
+      names[c].assign(data + pos + 4, len);
+      pos += 4 + len;
+    }
+    pos += (8 - pos % 8) % 8;
+
+    for(uint64_t b = 0; b < n_blocks; b++){
+      if(pos + 8 > size)
+        return truncated(path, err);
+      std::memcpy(&rows, data + pos, sizeof(uint64_t));
+      pos += 8;
+      if(pos + rows * n_cols * sizeof(double) > size)
+        return truncated(path, err);
+      block_rows.push_back(rows);
+      block_pos.push_back(pos);
+      pos += rows * n_cols * sizeof(double);
+    }
+
+    return true;
+  }
+
+  int get_n_cols() const {return n_cols;}
+
+  uint64_t get_n_rows() const {return n_rows;}
+
+  size_t get_n_blocks() const {return block_rows.size();}
+
+  uint64_t get_block_rows(size_t b) const {return block_rows[b];}
+
+  const std::vector<std::string>& get_names() const {return names;}
+
+  // Pointer to the first row of a column in a block
+  const double* column(size_t b, int c) const {
+    return reinterpret_cast<const double *>(data + block_pos[b] + (size_t)c * block_rows[b] * sizeof(double));
+  }
+
+private:
+  const char *data = nullptr;
+  size_t size = 0;
+  uint32_t n_cols = 0;
+  uint64_t n_rows = 0;
+  std::vector<std::string> names;
+  std::vector<uint64_t> block_rows;
+  std::vector<size_t> block_pos;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE, mapping = NULL;
+#endif
+
+  bool truncated(const std::string &path, std::string &err){
+    err = "The columnar dataset " + path + " is truncated.";
+    return false;
+  }
+
+#ifdef _WIN32
+  bool map(const std::string &path){
+    LARGE_INTEGER len;
+
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                       FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &len) || len.QuadPart == 0)
+      return false;
+    size = len.QuadPart;
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL)
+      return false;
+    data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+    return data != nullptr;
+  }
+
+  void unmap(){
+    if(data)
+      UnmapViewOfFile(data);
+    if(mapping != NULL)
+      CloseHandle(mapping);
+    if(file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+  }
+#else
+  bool map(const std::string &path){
+    struct stat st;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    void *res;
+
+    if(fd < 0)
+      return false;
+    if(fstat(fd, &st) != 0 || st.st_size == 0){
+      ::close(fd);
+      return false;
+    }
+    size = st.st_size;
+    res = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(res == MAP_FAILED)
+      return false;
+    data = static_cast<const char *>(res);
+    madvise(res, size, MADV_SEQUENTIAL);
+
+    return true;
+  }
+
+  void unmap(){
+    if(data)
+      munmap(const_cast<char *>(data), size);
+  }
+#endif
+};
+
+// Sufficient statistics of some columns of a columnar file
+//
+// The blocks are split into chunks of at most chunk_rows rows, whose partial
+// statistics are computed in parallel and then merged in the order of the
+// rows, so the result does not depend on the number of threads. The chunks
+// are processed in waves of a few per thread, which bounds the memory used by
+// the partial statistics regardless of the number of rows.
+//
+// @param file the mapped file
+// @param col_idx the 0-based column of the file of each column of the statistics
+// @param n_threads number of threads
+// @param chunk_rows maximum number of rows of each chunk
+// @return the statistics of the columns
+inline std::shared_ptr<natSuffStats> nat_file_suff_stats(const natColumnFile &file, const std::vector<int> &col_idx,
+                                                         int n_threads, uint64_t chunk_rows = 65536){
+  std::vector<std::pair<size_t, uint64_t>> chunks; // Block and first row of each chunk
+  std::vector<std::unique_ptr<natSuffStats>> parts;
+  std::shared_ptr<natSuffStats> res = std::make_shared<natSuffStats>(col_idx.size());
+  natThreadPool pool(n_threads);
+  size_t wave = 4 * pool.get_n_threads();
+
+  for(size_t b = 0; b < file.get_n_blocks(); b++)
+    for(uint64_t r = 0; r < file.get_block_rows(b); r += chunk_rows)
+      chunks.push_back(std::make_pair(b, r));
+  parts.resize(std::min(wave, chunks.size()));
+
+  for(size_t w0 = 0; w0 < chunks.size(); w0 += wave){
+    size_t n = std::min(wave, chunks.size() - w0);
+
+    pool.parallel_for(n, [&](size_t i, int){
+      size_t b = chunks[w0 + i].first;
+      uint64_t first = chunks[w0 + i].second;
+      uint64_t rows = std::min(chunk_rows, file.get_block_rows(b) - first);
+      std::vector<const double *> cols(col_idx.size());
+
+      for(size_t c = 0; c < col_idx.size(); c++)
+        cols[c] = file.column(b, col_idx[c]) + first;
+      parts[i].reset(new natSuffStats(col_idx.size()));
+      parts[i]->add_columns(cols, rows);
+    });
+
+    for(size_t i = 0; i < n; i++)
+      res->merge(*parts[i]);
+  }
+
+  return res;
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef Rcpp_head
+#define Rcpp_head
+#include <Rcpp.h>
+using namespace Rcpp;
+#endif
+
+#include "columnar.h"
+
+#ifndef nat_columnar_r_op
+#define nat_columnar_r_op
+void nat_write_columns_cpp(const Rcpp::List &dt, const Rcpp::StringVector &names, std::string file, bool append);
+Rcpp::StringVector nat_columns_names_cpp(std::string file);
+#endif
@@ -0,0 +1,366 @@
+#ifndef nat_discrete_op
+#define nat_discrete_op
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "family_cache.h"
+
+// Logarithm of the gamma function of x > 0
+//
+// std::lgamma sets the global signgam in some C libraries, so it cannot be
+// called while other threads score families. Small arguments are shifted up
+// to 10 with lgamma(x) = lgamma(x + 1) - log(x) and the rest use the Stirling
+// series, which is accurate to about 1e-14 from there on.
+inline double nat_log_gamma(double x){
+  double shift = 1, z;
+
+  while(x < 10){
+    shift *= x;
+    x += 1;
+  }
+  z = 1 / (x * x);
+
+  return (x - 0.5) * std::log(x) - x + 0.91893853320467274178
+    + (1.0 / 12 - z * (1.0 / 360 - z * (1.0 / 1260 - z * (1.0 / 1680 - z / 1188)))) / x
+    - std::log(shift);
+}
+
+// Logarithm of Gamma(a + n) / Gamma(a), the rising factorial of a
+//
+// Sparse contingency tables are mostly counts of one or a few rows, for which
+// a single logarithm of the product is much cheaper than two log-gammas.
+inline double nat_log_rising(double a, uint32_t n){
+  double prod = 1;
+
+  if(n > 16)
+    return nat_log_gamma(a + n) - nat_log_gamma(a);
+  for(uint32_t t = 0; t < n; t++)
+    prod *= a + t;
+
+  return std::log(prod);
+}
+
+// Discrete dataset stored by columns as small integer codes
+//
+// Each column keeps the code of the level of every row in a byte, so a column
+// can have up to 256 levels and counting a family reads a few contiguous
+// bytes per row. The number of levels of a column is the one of its factor in
+// R, even if some of them never appear, as bnlearn does. The dataset is
+// encoded once and then only read, so it can be shared between threads.
+class natCodedData {
+public:
+  // @param levels number of levels of each column
+  natCodedData(const std::vector<int> &levels) : n(0), levels(levels), cols(levels.size()){}
+
+  // Add a block of rows stored by columns
+  //
+  // @param src pointers to the first row of the block in each column
+  // @param n_rows number of rows in the block
+  // @param first_code code of the first level, 1 for the factors of R
+  // @return false if some code is out of the levels of its column, NA
+  // included, in which case nothing is added
+  bool add_columns(const std::vector<const int *> &src, size_t n_rows, int first_code = 0){
+    for(size_t i = 0; i < cols.size(); i++)
+      for(size_t r = 0; r < n_rows; r++)
+        if(src[i][r] < first_code || src[i][r] - first_code >= levels[i])
+          return false;
+
+    for(size_t i = 0; i < cols.size(); i++){
+      cols[i].reserve(n + n_rows);
+      for(size_t r = 0; r < n_rows; r++)
+        cols[i].push_back((uint8_t)(src[i][r] - first_code));
+    }
+    n += n_rows;
+
+    return true;
+  }
+
+  // Add the rows of a multivariate time series folded into max_size time
+  // slices, as natSuffStats::add_series does: the folded column of the
+  // variable j in the time slice k is the series j starting k instants later
+  //
+  // @param series pointers to the first instant of each variable. Their
+  // number times max_size has to be the number of columns.
+  // @param n_rows number of instants in the series
+  // @param max_size number of time slices
+  // @param first_code code of the first level, 1 for the factors of R
+  // @return false if some code is out of the levels of its column
+  bool add_series(const std::vector<const int *> &series, size_t n_rows, int max_size, int first_code = 0){
+    int n_series = series.size();
+    std::vector<const int *> src(cols.size());
+
+    // Too short to fill a single folded row
+    if(n_rows < (size_t)max_size)
+      return true;
+
+    for(int k = 0; k < max_size; k++)
+      for(int j = 0; j < n_series; j++)
+        src[k * n_series + j] = series[j] + k;
+
+    return add_columns(src, n_rows - max_size + 1, first_code);
+  }
+
+  const uint8_t* get_column(int i) const {return cols[i].data();}
+
+  int get_levels(int i) const {return levels[i];}
+
+  size_t get_n() const {return n;}
+
+  int get_n_cols() const {return cols.size();}
+
+private:
+  size_t n;
+  std::vector<int> levels;
+  std::vector<std::vector<uint8_t>> cols;
+};
+
+// Configurations of a set of parents in the rows of a dataset. Only the
+// configurations that appear in the data are numbered.
+struct natParentConfigs {
+  std::vector<uint32_t> ids; // Configuration of each row
+  std::vector<uint32_t> counts; // Number of rows of each configuration
+};
+
+// Work buffers of the counting of a family
+struct natCountBuffers {
+  std::vector<uint64_t> keys, keys_tmp;
+  std::vector<uint32_t> rows, rows_tmp, table;
+  std::vector<unsigned int> pa_key;
+};
+
+// Largest key space that is counted with a table instead of sorting the keys.
+// Clearing and scanning a table is cheaper than the passes of the radix sort
+// while the table is not much larger than the number of rows.
+inline uint64_t nat_dense_limit(size_t n_rows){
+  return 2 * (uint64_t)n_rows + 4096;
+}
+
+// Count the keys of n rows in a table of n_keys entries
+//
+// Small tables, where consecutive rows often hit the same entry, are split
+// into four interleaved copies so that those increments do not wait on each
+// other, and the copies are added at the end.
+//
+// @param n number of rows
+// @param n_keys upper bound of the keys
+// @param table where the count of each key is returned
+// @param key the key of a row
+template <class F>
+void nat_count_keys(size_t n, uint64_t n_keys, std::vector<uint32_t> &table, F key){
+  if(n_keys > 1024){
+    table.assign(n_keys, 0);
+    for(size_t i = 0; i < n; i++)
+      table[key(i)]++;
+    return;
+  }
+
+  size_t i = 0;
+  table.assign(4 * n_keys, 0);
+  uint32_t *t0 = table.data(), *t1 = t0 + n_keys, *t2 = t1 + n_keys, *t3 = t2 + n_keys;
+  for(; i + 4 <= n; i += 4){
+    t0[key(i)]++;
+    t1[key(i + 1)]++;
+    t2[key(i + 2)]++;
+    t3[key(i + 3)]++;
+  }
+  for(; i < n; i++)
+    t0[key(i)]++;
+  for(uint64_t k = 0; k < n_keys; k++)
+    t0[k] += t1[k] + t2[k] + t3[k];
+  table.resize(n_keys);
+}
+
+// Sort keys in [0, n_keys) with a least significant digit radix sort of 11
+// bits per pass, carrying the index of the row of each key if rows is not empty
+//
+// @param keys the keys to sort
+// @param rows the row of each key, or empty
+// @param n_keys upper bound of the keys
+// @param buf the work buffers
+inline void nat_radix_sort(std::vector<uint64_t> &keys, std::vector<uint32_t> &rows,
+                           uint64_t n_keys, natCountBuffers &buf){
+  const int digit = 11;
+  const size_t n_buckets = (size_t)1 << digit;
+  size_t n = keys.size();
+  bool carry = !rows.empty();
+  size_t count[n_buckets];
+
+  buf.keys_tmp.resize(n);
+  if(carry)
+    buf.rows_tmp.resize(n);
+  for(int shift = 0; shift < 64 && (n_keys - 1) >> shift; shift += digit){
+    std::fill(count, count + n_buckets, 0);
+    for(size_t i = 0; i < n; i++)
+      count[(keys[i] >> shift) & (n_buckets - 1)]++;
+    for(size_t b = 0, acc = 0; b < n_buckets; b++){
+      size_t c = count[b];
+      count[b] = acc;
+      acc += c;
+    }
+    for(size_t i = 0; i < n; i++){
+      size_t pos = count[(keys[i] >> shift) & (n_buckets - 1)]++;
+      buf.keys_tmp[pos] = keys[i];
+      if(carry)
+        buf.rows_tmp[pos] = rows[i];
+    }
+    keys.swap(buf.keys_tmp);
+    if(carry)
+      rows.swap(buf.rows_tmp);
+  }
+}
+
+// Number the distinct keys of the rows in the order of the keys
+//
+// Small key spaces are counted with a table. Larger ones, where most keys
+// never appear, are sorted with the row of each key and numbered by runs.
+//
+// @param keys the packed key of each row, in [0, n_keys). It is overwritten.
+// @param n_keys upper bound of the keys
+// @param res where the configuration of each row and their counts are returned
+// @param buf the work buffers
+inline void nat_dense_ids(std::vector<uint64_t> &keys, uint64_t n_keys, natParentConfigs &res,
+                          natCountBuffers &buf){
+  size_t n = keys.size();
+
+  res.ids.resize(n);
+  res.counts.clear();
+  if(n_keys <= nat_dense_limit(n)){
+    std::vector<uint32_t> &table = buf.table;
+    nat_count_keys(n, n_keys, table, [&](size_t r){return keys[r];});
+    // The table goes from counts to ids
+    for(uint64_t k = 0; k < n_keys; k++){
+      if(table[k]){
+        res.counts.push_back(table[k]);
+        table[k] = res.counts.size() - 1;
+      }
+    }
+    for(size_t r = 0; r < n; r++)
+      res.ids[r] = table[keys[r]];
+  }
+  else{
+    buf.rows.resize(n);
+    for(size_t r = 0; r < n; r++)
+      buf.rows[r] = r;
+    nat_radix_sort(keys, buf.rows, n_keys, buf);
+    for(size_t i = 0; i < n; i++){
+      if(i == 0 || keys[i] != keys[i - 1])
+        res.counts.push_back(0);
+      res.counts.back()++;
+      res.ids[buf.rows[i]] = res.counts.size() - 1;
+    }
+  }
+}
+
+// Visit the non-empty cells of the contingency table of a node and its parents
+//
+// The key of a row is its parent configuration times the levels of the node
+// plus the level of the node. Tables that are not much larger than the data
+// are counted directly; otherwise the keys are sorted and counted by runs.
+//
+// @param pa the configurations of the parents
+// @param node the codes of the node
+// @param r the number of levels of the node
+// @param buf the work buffers
+// @param cell called with the parent configuration and the count of each cell
+template <class F>
+void nat_family_counts(const natParentConfigs &pa, const uint8_t *node, int r,
+                       natCountBuffers &buf, F cell){
+  size_t n = pa.ids.size();
+  uint64_t n_keys = (uint64_t)pa.counts.size() * r;
+
+  if(n_keys <= nat_dense_limit(n)){
+    std::vector<uint32_t> &table = buf.table;
+    nat_count_keys(n, n_keys, table, [&](size_t i){return (uint64_t)pa.ids[i] * r + node[i];});
+    for(uint64_t k = 0; k < n_keys; k++)
+      if(table[k])
+        cell(k / r, table[k]);
+  }
+  else{
+    std::vector<uint64_t> &keys = buf.keys;
+    std::vector<uint32_t> no_rows;
+    keys.resize(n);
+    for(size_t i = 0; i < n; i++)
+      keys[i] = (uint64_t)pa.ids[i] * r + node[i];
+    nat_radix_sort(keys, no_rows, n_keys, buf);
+    for(size_t i = 0, run = 1; i < n; i++, run++){
+      if(i + 1 == n || keys[i + 1] != keys[i]){
+        cell(keys[i] / r, run);
+        run = 0;
+      }
+    }
+  }
+}
+
+// Bounded cache of the configurations of parent sets
+//
+// Families that share their parents, like the same node after moves that did
+// not touch its row or different nodes with the same parents, reuse the
+// configurations instead of counting the parents again. The key is the list
+// of columns of the parents. The entries hold one configuration per row, so
+// the cache is bounded by memory instead of by number of entries, and the
+// least recently used sets are evicted first. The entries are shared
+// pointers, so one evicted while a thread still counts with it stays alive
+// until that thread is done. The cache can be used from several threads.
+class natConfigCache {
+public:
+  // @param max_bytes memory that the cached configurations can use. 0 disables the cache
+  natConfigCache(size_t max_bytes) : max_bytes(max_bytes), bytes(0){}
+
+  // @return the configurations of the parents, or nullptr if they are not cached
+  std::shared_ptr<const natParentConfigs> find(const std::vector<unsigned int> &key){
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = index.find(key);
+
+    if(it == index.end())
+      return nullptr;
+    lru.splice(lru.begin(), lru, it->second); // Move it to the front
+
+    return it->second->configs;
+  }
+
+  void insert(const std::vector<unsigned int> &key, const std::shared_ptr<const natParentConfigs> &configs){
+    size_t size = entry_bytes(key, *configs);
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if(size > max_bytes || index.find(key) != index.end())
+      return;
+    while(bytes + size > max_bytes){
+      bytes -= entry_bytes(lru.back().key, *lru.back().configs);
+      index.erase(lru.back().key);
+      lru.pop_back();
+    }
+    lru.push_front(natConfigEntry{key, configs});
+    index[key] = lru.begin();
+    bytes += size;
+  }
+
+  size_t get_bytes() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return bytes;
+  }
+
+private:
+  struct natConfigEntry {
+    std::vector<unsigned int> key;
+    std::shared_ptr<const natParentConfigs> configs;
+  };
+
+  size_t max_bytes, bytes;
+  mutable std::mutex mtx;
+  std::list<natConfigEntry> lru;
+  std::unordered_map<std::vector<unsigned int>, std::list<natConfigEntry>::iterator, natFamilyKeyHash> index;
+
+  static size_t entry_bytes(const std::vector<unsigned int> &key, const natParentConfigs &configs){
+    return sizeof(natConfigEntry) + key.size() * sizeof(unsigned int) +
+      (configs.ids.size() + configs.counts.size()) * sizeof(uint32_t);
+  }
+};
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef nat_family_cache_op
+#define nat_family_cache_op
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include "words.h"
+
+// Hash of a family key. FNV-1a over the words of the key.
+struct natFamilyKeyHash {
+  size_t operator()(const unsigned int *key, size_t len) const {
+    size_t res = 14695981039346656037ULL;
+    for(size_t i = 0; i < len; i++){
+      res ^= key[i];
+      res *= 1099511628211ULL;
+    }
+
+    return res;
+  }
+
+  size_t operator()(const std::vector<unsigned int> &key) const {
+    return (*this)(key.data(), key.size());
+  }
+};
+
+// Bounded cache of family scores
+//
+// The score of a family only depends on the node in t_0 and its row of n_vars
+// words in the causal list, so the key is the node followed by that row. Each
+// word is split into the 32 bit chunks needed for max_size - 1 bits, so the
+// keys are the same whatever the word type used to store the causal lists.
+// When the cache is full, the least recently used family is evicted. A
+// capacity of 0 disables the cache.
+//
+// The cache can be used from several threads at the same time as long as each
+// one passes its own key buffer. Keys are spread by their hash over shards
+// that have their own lock and LRU list, so threads rarely wait on each other.
+// Small caches use a single shard, so that the eviction order stays exact.
+class natFamilyCache {
+public:
+  // @param n_vars number of variables in t_0
+  // @param capacity maximum number of families kept
+  // @param max_size maximum number of timeslices of the DBN
+  natFamilyCache(int n_vars, size_t capacity, int max_size) :
+    n_vars(n_vars), capacity(capacity){
+    chunks = (max_size + 30) / 32;
+    if(chunks < 1)
+      chunks = 1;
+    n_shards = capacity / min_shard_size;
+    if(n_shards < 1)
+      n_shards = 1;
+    if(n_shards > max_shards)
+      n_shards = max_shards;
+    for(size_t i = 0; i < n_shards; i++){
+      // The first shards take the remainder of the capacity
+      size_t shard_cap = capacity / n_shards + (i < capacity % n_shards);
+      shards.push_back(std::unique_ptr<natCacheShard>(new natCacheShard(shard_cap)));
+    }
+  }
+
+  // Look for a family in the cache
+  //
+  // @param node index of the node in t_0
+  // @param row pointer to the n_vars words that define its parents
+  // @param score where the cached score is returned
+  // @param key buffer where the key is built
+  // @return whether the family was found or not
+  template <typename W>
+  bool find(int node, const W *row, double &score, std::vector<unsigned int> &key){
+    fill_key(node, row, key);
+    natCacheShard &shard = get_shard(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    if(capacity == 0){
+      shard.misses++;
+      return false;
+    }
+
+    auto it = shard.index.find(key);
+    if(it == shard.index.end()){
+      shard.misses++;
+      return false;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second); // Move it to the front
+    score = it->second->score;
+    shard.hits++;
+
+    return true;
+  }
+
+  template <typename W>
+  bool find(int node, const W *row, double &score){
+    return find(node, row, score, key_buf);
+  }
+
+  // Insert a family in the cache, evicting the least recently used one if full
+  //
+  // @param node index of the node in t_0
+  // @param row pointer to the n_vars words that define its parents
+  // @param score the score of the family
+  // @param key buffer where the key is built
+  template <typename W>
+  void insert(int node, const W *row, double score, std::vector<unsigned int> &key){
+    if(capacity == 0)
+      return;
+
+    fill_key(node, row, key);
+    natCacheShard &shard = get_shard(key);
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    if(shard.capacity == 0 || shard.index.find(key) != shard.index.end())
+      return;
+
+    if(shard.index.size() >= shard.capacity){
+      shard.index.erase(shard.lru.back().key);
+      shard.lru.pop_back();
+      shard.evictions++;
+    }
+
+    shard.lru.push_front(natCacheEntry{key, score});
+    shard.index[key] = shard.lru.begin();
+  }
+
+  template <typename W>
+  void insert(int node, const W *row, double score){
+    insert(node, row, score, key_buf);
+  }
+
+  void clear(){
+    for(auto &shard : shards){
+      std::lock_guard<std::mutex> lock(shard->mtx);
+      shard->lru.clear();
+      shard->index.clear();
+      shard->hits = shard->misses = shard->evictions = 0;
+    }
+  }
+
+  // The counters can be read while other threads use the cache, as swarms
+  // sharing it do
+  size_t get_hits() const {
+    size_t res = 0;
+    for(auto &shard : shards){
+      std::lock_guard<std::mutex> lock(shard->mtx);
+      res += shard->hits;
+    }
+    return res;
+  }
+
+  size_t get_misses() const {
+    size_t res = 0;
+    for(auto &shard : shards){
+      std::lock_guard<std::mutex> lock(shard->mtx);
+      res += shard->misses;
+    }
+    return res;
+  }
+
+  size_t get_evictions() const {
+    size_t res = 0;
+    for(auto &shard : shards){
+      std::lock_guard<std::mutex> lock(shard->mtx);
+      res += shard->evictions;
+    }
+    return res;
+  }
+
+  size_t get_size() const {
+    size_t res = 0;
+    for(auto &shard : shards){
+      std::lock_guard<std::mutex> lock(shard->mtx);
+      res += shard->index.size();
+    }
+    return res;
+  }
+
+  size_t get_capacity() const {return capacity;}
+
+  int get_n_vars() const {return n_vars;}
+
+  // Number of words of the keys of the families
+  size_t get_key_len() const {return 1 + n_vars * chunks;}
+
+private:
+  struct natCacheEntry {
+    std::vector<unsigned int> key;
+    double score;
+  };
+
+  struct natCacheShard {
+    natCacheShard(size_t capacity) : capacity(capacity), hits(0), misses(0), evictions(0){
+      index.reserve(capacity);
+    }
+
+    size_t capacity, hits, misses, evictions;
+    std::mutex mtx;
+    std::list<natCacheEntry> lru;
+    std::unordered_map<std::vector<unsigned int>, std::list<natCacheEntry>::iterator, natFamilyKeyHash> index;
+  };
+
+  static const size_t min_shard_size = 1024;
+  static const size_t max_shards = 64;
+
+  int n_vars, chunks;
+  size_t capacity, n_shards;
+  std::vector<unsigned int> key_buf;
+  std::vector<std::unique_ptr<natCacheShard>> shards;
+
+  template <typename W>
+  void fill_key(int node, const W *row, std::vector<unsigned int> &key) const {
+    key.resize(1 + n_vars * chunks);
+    key[0] = node;
+    for(int j = 0; j < n_vars; j++)
+      for(int c = 0; c < chunks; c++)
+        key[1 + j * chunks + c] = nat_word_chunk(row[j], c);
+  }
+
+  natCacheShard& get_shard(const std::vector<unsigned int> &key){
+    if(n_shards == 1)
+      return *shards[0];
+    // The low bits of the hash are used by the unordered_map of the shard, so
+    // the shard is taken from the high bits of the hash mixed by a multiply.
+    // The hash is only 32 bits wide where size_t is.
+    uint64_t h = (uint64_t)natFamilyKeyHash()(key) * 0x9E3779B97F4A7C15ULL;
+    return *shards[(h >> 32) % n_shards];
+  }
+};
+
+// Usage statistics of one or several caches, added up
+struct natCacheStats {
+  size_t hits = 0, misses = 0, evictions = 0, size = 0, capacity = 0;
+
+  void add(const natFamilyCache &cache){
+    hits += cache.get_hits();
+    misses += cache.get_misses();
+    evictions += cache.get_evictions();
+    size += cache.get_size();
+    capacity += cache.get_capacity();
+  }
+};
+
+#endif
@@ -0,0 +1,290 @@
+#ifndef nat_islands_op
+#define nat_islands_op
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include "swarm.h"
+
+// Topologies of the migration between islands
+//
+// ring: each island sends its best position to the next one
+// star: every island sends its best position to the first one, which sends
+// its own best position back to all of them
+// full: every island sends its best position to all the others
+enum natTopology {NAT_TOPOLOGY_RING, NAT_TOPOLOGY_STAR, NAT_TOPOLOGY_FULL};
+
+// Island model of independent swarms
+//
+// Each island is a natSwarm with its own particles and random streams, and
+// all of them advance one iteration at a time in parallel. Every 'interval'
+// iterations the islands exchange their global bests along the topology: a
+// migrant replaces the worst particle of the island that receives it, if it
+// is better. The exchange is done after all islands have finished the
+// iteration and with copies of the bests taken beforehand, so the results do
+// not depend on the number of threads nor on the order of the islands.
+//
+// The islands share the sufficient statistics of the scorer. They can also
+// share its cache of family scores, which is safe to use from several threads.
+// In that case an island can find in the cache the families scored by the
+// others. Each island counts the hits of its own lookups, so the hits of the
+// model are the sum of the ones of the islands.
+//
+// The particle i of the whole model is the particle i % n_inds of the island
+// i / n_inds, and it draws from the stream i of the seed, as in a single swarm.
+// W and S are the word and the scorer of the swarms, as in natSwarm.
+template <typename W, class S = natBgeScore>
+class natIslands : public natSwarmBase {
+public:
+  // @param scorer the scorer used to evaluate the positions. It is not owned by the islands
+  // @param n_islands number of islands
+  // @param n_inds number of particles in each island
+  // @param max_size maximum number of timeslices of the DBN
+  // @param params the parameters of the PSO
+  // @param n_threads total number of threads. The islands run in parallel and
+  // the remaining threads are split between them to move and score their particles
+  // @param interval number of iterations between migrations. 0 disables them
+  // @param topology the islands that exchange their bests
+  // @param share_cache whether all islands use the cache of the scorer or each one
+  // has its own cache of the same size
+  natIslands(S *scorer, int n_islands, int n_inds, int max_size, const natPsoParams &params,
+             int n_threads, int interval, natTopology topology, bool share_cache) :
+    n_islands(n_islands), n_inds(n_inds), n_threads(n_threads), interval(interval), it(0),
+    pool(std::min(n_threads, n_islands)){
+    int island_threads = std::max(1, n_threads / n_islands);
+
+    for(int k = 0; k < n_islands; k++){
+      S *sc = scorer;
+      if(!share_cache && k > 0){
+        sc = scorer->clone(scorer->get_cache().get_capacity());
+        scorers.push_back(std::unique_ptr<S>(sc));
+      }
+      islands.push_back(std::unique_ptr<natSwarm<W, S>>(new natSwarm<W, S>(sc, n_inds, max_size, params, island_threads)));
+    }
+    len = islands[0]->get_len();
+    lb_scr.assign((size_t)n_islands * n_inds, -INFINITY);
+    migrants.resize(n_islands);
+    migrant_scr.resize(n_islands);
+    init_routes(topology);
+  }
+
+  void set_particle(int i, const double *cl, const double *v, const double *v_neg, int n_op){
+    islands[i / n_inds]->set_particle(i % n_inds, cl, v, v_neg, n_op);
+  }
+
+  void seed(uint64_t seed){
+    for(int k = 0; k < n_islands; k++)
+      islands[k]->seed(seed, (uint64_t)k * n_inds);
+  }
+
+  void randomize(const double *probs, double p){
+    pool.parallel_for(n_islands, [&](size_t k, int){
+      islands[k]->randomize(probs, p);
+    });
+  }
+
+  // Each island starts its first n_warm particles at or near the priors
+  void warm_start(const double *cls, int n_priors, int n_warm, double noise, double p){
+    pool.parallel_for(n_islands, [&](size_t k, int){
+      islands[k]->warm_start(cls, n_priors, n_warm, noise, p);
+    });
+  }
+
+  void evaluate(){
+    pool.parallel_for(n_islands, [this](size_t k, int){
+      islands[k]->evaluate();
+    });
+    update_lb_scr();
+  }
+
+  // Perform one iteration of every island and migrate their bests if it is due
+  void step(){
+    natIterStats stats;
+
+    pool.parallel_for(n_islands, [this](size_t k, int){
+      islands[k]->step();
+    });
+    it++;
+    if(interval > 0 && it % interval == 0)
+      migrate();
+    update_lb_scr();
+
+    // The islands run at the same time, so the slowest one sets the times
+    stats = islands[0]->get_history().back();
+    stats.iteration = it;
+    stats.mean_abs_op /= n_islands;
+    stats.diversity /= n_islands;
+    for(int k = 1; k < n_islands; k++){
+      const natIterStats &s = islands[k]->get_history().back();
+      stats.move_time = std::max(stats.move_time, s.move_time);
+      stats.score_time = std::max(stats.score_time, s.score_time);
+      stats.n_rescored += s.n_rescored;
+      stats.cache_hits += s.cache_hits;
+      stats.gb_scr = std::max(stats.gb_scr, s.gb_scr);
+      stats.mean_abs_op += s.mean_abs_op / n_islands;
+      stats.diversity += s.diversity / n_islands;
+    }
+    history.push_back(stats);
+  }
+
+  double get_gb_scr() const {return best()->get_gb_scr();}
+
+  int get_gb_n_arcs() const {return best()->get_gb_n_arcs();}
+
+  std::vector<double> get_gb_ps() const {return best()->get_gb_ps();}
+
+  std::vector<int> get_gb_arcs() const {return best()->get_gb_arcs();}
+
+  std::vector<double> get_positions() const {
+    std::vector<double> res;
+    for(int k = 0; k < n_islands; k++){
+      std::vector<double> ps = islands[k]->get_positions();
+      res.insert(res.end(), ps.begin(), ps.end());
+    }
+    return res;
+  }
+
+  const std::vector<double>& get_lb_scr() const {return lb_scr;}
+
+  int get_n_inds() const {return n_islands * n_inds;}
+
+  size_t get_len() const {return len;}
+
+  int get_iteration() const {return it;}
+
+  int get_n_threads() const {return n_threads;}
+
+  int get_word_bits() const {return natWordBits<W>::value;}
+
+  void set_isa(natIsa isa){
+    for(int k = 0; k < n_islands; k++)
+      islands[k]->set_isa(isa);
+  }
+
+  natIsa get_isa() const {return islands[0]->get_isa();}
+
+  // The records of the islands are merged: the times are the ones of the
+  // slowest island, the counts are added, the global best is the best one of
+  // all islands and the mean operations and diversity are the means of the
+  // islands. The diversity is measured inside each island.
+  const std::vector<natIterStats>& get_history() const {return history;}
+
+  // The islands with a cache of their own add theirs to the one of the scorer
+  natCacheStats get_cache_stats() const {
+    natCacheStats res = islands[0]->get_cache_stats();
+    for(const std::unique_ptr<S> &sc : scorers)
+      res.add(sc->get_cache());
+    return res;
+  }
+
+  void save(natCheckpointOut &out) const {
+    out.put(n_islands);
+    out.put(it);
+    out.put(history);
+    for(int k = 0; k < n_islands; k++)
+      islands[k]->save(out);
+  }
+
+  bool load(natCheckpointIn &in){
+    int n = 0;
+
+    in.get(n);
+    if(!in.good() || n != n_islands){
+      in.fail();
+      return false;
+    }
+    in.get(it);
+    in.get(history);
+    for(int k = 0; k < n_islands && in.good(); k++)
+      islands[k]->load(in);
+    update_lb_scr();
+
+    return in.good();
+  }
+
+  int get_n_islands() const {return n_islands;}
+
+  const natSwarm<W, S>& get_island(int k) const {return *islands[k];}
+
+private:
+  int n_islands, n_inds, n_threads, interval, it;
+  size_t len;
+  natThreadPool pool; // One thread per island, at most
+  std::vector<std::unique_ptr<natSwarm<W, S>>> islands;
+  std::vector<std::unique_ptr<S>> scorers; // The own scorers of the islands that do not share the cache
+  std::vector<std::pair<int, int>> routes; // Sender and receiver of each migration
+  std::vector<std::vector<W>> migrants;
+  std::vector<double> migrant_scr, lb_scr;
+  std::vector<natIterStats> history;
+
+  void init_routes(natTopology topology){
+    for(int k = 0; k < n_islands; k++){
+      if(topology == NAT_TOPOLOGY_RING && n_islands > 1)
+        routes.push_back(std::make_pair(k, (k + 1) % n_islands));
+      else if(topology == NAT_TOPOLOGY_STAR && k > 0){
+        routes.push_back(std::make_pair(k, 0));
+        routes.push_back(std::make_pair(0, k));
+      }
+      else if(topology == NAT_TOPOLOGY_FULL){
+        for(int l = 0; l < n_islands; l++)
+          if(l != k)
+            routes.push_back(std::make_pair(k, l));
+      }
+    }
+  }
+
+  void migrate(){
+    for(int k = 0; k < n_islands; k++){
+      migrants[k] = islands[k]->get_gb_words();
+      migrant_scr[k] = islands[k]->get_gb_scr();
+    }
+    for(const std::pair<int, int> &r : routes)
+      islands[r.second]->immigrate(migrants[r.first].data(), migrant_scr[r.first]);
+  }
+
+  void update_lb_scr(){
+    for(int k = 0; k < n_islands; k++){
+      const std::vector<double> &scr = islands[k]->get_lb_scr();
+      std::copy(scr.begin(), scr.end(), lb_scr.begin() + (size_t)k * n_inds);
+    }
+  }
+
+  // Island with the best global best, the first one on ties
+  const natSwarm<W, S>* best() const {
+    int res = 0;
+    for(int k = 1; k < n_islands; k++)
+      if(islands[k]->get_gb_scr() > islands[res]->get_gb_scr())
+        res = k;
+    return islands[res].get();
+  }
+};
+
+// Create an island model that stores the causal units in the smallest word
+// that holds max_size - 1 bits, as nat_create_swarm does
+//
+// @return the new islands, or nullptr if max_size is greater than NAT_MAX_SLICES
+template <class S>
+natSwarmBase* nat_create_islands(S *scorer, int n_islands, int n_inds, int max_size,
+                                        const natPsoParams &params, int n_threads, int interval,
+                                        natTopology topology, bool share_cache){
+  int bits = max_size - 1;
+
+  if(bits <= 8)
+    return new natIslands<uint8_t, S>(scorer, n_islands, n_inds, max_size, params, n_threads, interval, topology, share_cache);
+  if(bits <= 16)
+    return new natIslands<uint16_t, S>(scorer, n_islands, n_inds, max_size, params, n_threads, interval, topology, share_cache);
+  if(bits <= 32)
+    return new natIslands<uint32_t, S>(scorer, n_islands, n_inds, max_size, params, n_threads, interval, topology, share_cache);
+  if(bits <= 64)
+    return new natIslands<uint64_t, S>(scorer, n_islands, n_inds, max_size, params, n_threads, interval, topology, share_cache);
+  if(bits <= 128)
+    return new natIslands<natBitset<2>, S>(scorer, n_islands, n_inds, max_size, params, n_threads, interval, topology, share_cache);
+  if(bits <= 256)
+    return new natIslands<natBitset<4>, S>(scorer, n_islands, n_inds, max_size, params, n_threads, interval, topology, share_cache);
+
+  return nullptr;
+}
+
+#endif
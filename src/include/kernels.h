@@ -0,0 +1,538 @@
+#ifndef nat_kernels_op
+#define nat_kernels_op
+
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstddef>
+#include <algorithm>
+#include "words.h"
+
+// Position and velocity algebra over raw causal lists
+//
+// These are the kernels behind the Rcpp functions in position.cpp and
+// velocity.cpp and behind the native swarm. They work on plain arrays of any
+// numeric type T, so they can operate both on the NumericVectors of the R6
+// objects and on the contiguous arenas of the swarm. They operate on the
+// word type natWord<T>: the storage type itself for the unsigned words of
+// the swarm and a 64 bit integer for the doubles of R. Randomness is drawn
+// from an Rng object with the interface described in rng.h, either the
+// native natCounterRng or an adapter of R's RNG.
+
+// Add a velocity to a position
+//
+// @param cl the position's causal list
+// @param vl the velocity's positive causal list
+// @param vl_neg the velocity's negative causal list
+// @param len length of the causal lists
+// @param n_arcs number of arcs present in the position
+// @return the new number of arcs. The position is modified in place.
+template <typename T>
+int nat_pos_plus_vel(T *cl, const T *vl, const T *vl_neg, size_t len, int n_arcs){
+  typedef typename natWord<T>::type W;
+  W pos, new_pos;
+
+  for(size_t i = 0; i < len; i++){
+    pos = nat_to_word<W>(cl[i]);
+    new_pos = static_cast<W>((pos | nat_to_word<W>(vl[i])) & ~nat_to_word<W>(vl_neg[i]));
+    n_arcs += nat_bitcount(new_pos) - nat_bitcount(pos);
+    cl[i] = nat_from_word<T>(new_pos);
+  }
+
+  return n_arcs;
+}
+
+// Subtract two positions to obtain the velocity that transforms ps1 into ps2
+//
+// @param ps1 the first position's causal list
+// @param ps2 the second position's causal list
+// @param vl the velocity's positive causal list
+// @param vl_neg the velocity's negative causal list
+// @param len length of the causal lists
+// @return the number of operations of the velocity
+template <typename T>
+int nat_pos_minus_pos(const T *ps1, const T *ps2, T *vl, T *vl_neg, size_t len){
+  typedef typename natWord<T>::type W;
+  W ps1_i, ps2_i, vl_i, vl_neg_i;
+  int n_abs = 0;
+
+  for(size_t i = 0; i < len; i++){
+    ps1_i = nat_to_word<W>(ps1[i]);
+    ps2_i = nat_to_word<W>(ps2[i]);
+    vl_i = static_cast<W>(ps2_i & ~ps1_i);
+    vl_neg_i = static_cast<W>(ps1_i & ~ps2_i);
+    vl[i] = nat_from_word<T>(vl_i);
+    vl_neg[i] = nat_from_word<T>(vl_neg_i);
+    n_abs += nat_bitcount(vl_i) + nat_bitcount(vl_neg_i);
+  }
+
+  return n_abs;
+}
+
+// Add two velocities. The result is stored in the first one. Operations that
+// appear both in the positive and the negative part cancel each other.
+//
+// @param vl1 the first velocity's positive part
+// @param vl1_neg the first velocity's negative part
+// @param vl2 the second velocity's positive part
+// @param vl2_neg the second velocity's negative part
+// @param len length of the causal lists
+// @param abs_op1 the number of {1,-1} operations in the first velocity
+// @param abs_op2 the number of {1,-1} operations in the second velocity
+// @return the total number of resulting operations
+template <typename T>
+int nat_vel_plus_vel(T *vl1, T *vl1_neg, const T *vl2, const T *vl2_neg, size_t len,
+                     int abs_op1, int abs_op2){
+  typedef typename natWord<T>::type W;
+  W pos1, pos2, neg1, neg2, mask;
+  int res = abs_op1 + abs_op2;
+
+  for(size_t i = 0; i < len; i++){
+    pos1 = nat_to_word<W>(vl1[i]);
+    pos2 = nat_to_word<W>(vl2[i]);
+    neg1 = nat_to_word<W>(vl1_neg[i]);
+    neg2 = nat_to_word<W>(vl2_neg[i]);
+
+    res -= nat_bitcount(static_cast<W>(pos1 & pos2)) + nat_bitcount(static_cast<W>(neg1 & neg2));
+    pos1 |= pos2;
+    neg1 |= neg2;
+    mask = static_cast<W>(pos1 & neg1);
+    if(!nat_is_zero(mask)){
+      pos1 ^= mask;
+      neg1 ^= mask;
+      res -= 2 * nat_bitcount(mask);
+    }
+
+    vl1[i] = nat_from_word<T>(pos1);
+    vl1_neg[i] = nat_from_word<T>(neg1);
+  }
+
+  return res;
+}
+
+// Pool of the open positions of a causal list
+//
+// The random operations of the velocities sample positions uniformly among
+// the ones still open, in the order of the causal list, and close them as they
+// fill up. The pool starts as a sorted array, where sampling is a single
+// access and closing a position shifts the ones after it. When the shifts add
+// up to a few times the length of the causal list, the pool moves to a bitmask
+// of the open positions with a Fenwick tree over the counts of its 64 bit
+// blocks, where both cost O(log len). Both forms keep the same positions in
+// the same order, so the draws do not depend on the form in use. The storage
+// is reused between calls, so no memory is allocated once it has grown.
+//
+// Filling the pool costs O(len), as the whole causal list is scanned for its
+// open positions, and the shifts of the sorted array before the switch are
+// bounded by 4 * len. A call with n_op operations costs O(len + n_op log len)
+// in total, not O(n_op).
+class natOpPool {
+public:
+  // Empty the pool for a causal list of len positions
+  void reset(size_t len){
+    this->len = len;
+    flat.clear();
+    shifted = 0;
+    tree_mode = false;
+  }
+
+  // Open a position. They have to be added in increasing order.
+  void add(size_t i){flat.push_back(i);}
+
+  size_t size() const {return n_open();}
+
+  // Index in the causal list of the k-th (0-based) open position
+  size_t select(int k) const {
+    if(!tree_mode)
+      return flat[k];
+
+    size_t b = 0;
+    for(size_t step = top; step > 0; step /= 2){
+      if(b + step < tree.size() && tree[b + step] <= k){
+        b += step;
+        k -= tree[b];
+      }
+    }
+
+    return 64 * b + nat_select_bit64(mask[b], k);
+  }
+
+  // Close the k-th open position, which is the position i of the causal list
+  void remove(int k, size_t i){
+    if(!tree_mode){
+      shifted += flat.size() - k;
+      flat.erase(flat.begin() + k);
+      if(shifted > 4 * len)
+        to_tree();
+      return;
+    }
+
+    mask[i / 64] &= ~(1ULL << (i % 64));
+    for(size_t b = i / 64 + 1; b < tree.size(); b += b & (~b + 1))
+      tree[b]--;
+    n_tree--;
+  }
+
+private:
+  size_t len = 0, shifted = 0, top = 0;
+  int n_tree = 0;
+  bool tree_mode = false;
+  std::vector<size_t> flat;
+  std::vector<uint64_t> mask;
+  std::vector<int> tree; // 1-based Fenwick tree over the blocks of mask
+
+  int n_open() const {return tree_mode ? n_tree : flat.size();}
+
+  void to_tree(){
+    size_t n = (len + 63) / 64;
+
+    mask.assign(n, 0);
+    tree.assign(n + 1, 0);
+    for(size_t i : flat)
+      mask[i / 64] |= 1ULL << (i % 64);
+    for(size_t b = 1; b <= n; b++)
+      tree[b] = nat_bitcount(mask[b - 1]);
+    for(size_t b = 1; b <= n; b++){
+      size_t c = b + (b & (~b + 1));
+      if(c <= n)
+        tree[c] += tree[b];
+    }
+    for(top = 1; top * 2 <= n; top *= 2);
+    n_tree = flat.size();
+    tree_mode = true;
+  }
+};
+
+// Multiply a velocity by a positive constant real number
+//
+// The number of operations of the velocity becomes floor(k * abs_op), bounded
+// by the maximum number of arcs in the network. Operations are randomly added
+// or removed one at a time until that number is reached. Each one samples a
+// position among the open ones and then one of its open bits, so scaling a
+// velocity costs a pass over the causal list plus O(log len) per operation.
+//
+// @param k the constant real number
+// @param vl the velocity's positive causal list
+// @param vl_neg the velocity's negative causal list
+// @param len length of the causal lists
+// @param abs_op the number of {1,-1} operations in the velocity
+// @param max_size the maximum size of the network
+// @param rng the source of random numbers
+// @param pool auxiliary pool reused between calls to avoid reallocations
+// @return the new total number of operations
+template <typename T, class Rng>
+int nat_cte_times_vel(float k, T *vl, T *vl_neg, size_t len, int abs_op, int max_size,
+                      Rng &rng, natOpPool &pool){
+  typedef typename natWord<T>::type W;
+  int res, max_op, n_op, pool_idx;
+  size_t pos_idx;
+  W pos, pos_neg, pos_mix, open, max_int, bit;
+  bool remove;
+
+  max_int = natWordOps<W>::low_mask(max_size - 1);
+  max_op = (max_size - 1) * len;
+
+  n_op = floor(k * abs_op);
+  if(n_op > max_op)
+    n_op = max_op;
+  res = n_op;
+
+  n_op = abs_op - n_op;
+  remove = n_op > 0; // Whether to add or remove arcs
+  n_op = std::abs(n_op);
+  if(n_op == 0)
+    return res;
+
+  // Find a pool of possible integers in the cl and cl_neg to operate
+  pool.reset(len);
+  for(size_t i = 0; i < len; i++){
+    pos_mix = static_cast<W>(nat_to_word<W>(vl[i]) | nat_to_word<W>(vl_neg[i]));
+    if((remove && !nat_is_zero(pos_mix)) || (!remove && pos_mix != max_int))
+      pool.add(i);
+  }
+
+  for(int i = 0; i < n_op && pool.size() > 0; i++){
+    // Sample a position from the pool
+    pool_idx = rng.index(pool.size());
+    pos_idx = pool.select(pool_idx);
+    pos = nat_to_word<W>(vl[pos_idx]);
+    pos_neg = nat_to_word<W>(vl_neg[pos_idx]);
+    pos_mix = static_cast<W>(pos | pos_neg);
+
+    // Sample one of its open bits and add it or remove it
+    open = remove ? pos_mix : static_cast<W>(pos_mix ^ max_int);
+    bit = natWordOps<W>::bit(nat_select_bit(open, rng.index(nat_bitcount(open))) - 1);
+
+    if(remove){
+      if(!nat_is_zero(static_cast<W>(pos & bit)))
+        pos ^= bit;
+      else
+        pos_neg ^= bit;
+      pos_mix = static_cast<W>(pos | pos_neg);
+      if(nat_is_zero(pos_mix))
+        pool.remove(pool_idx, pos_idx);
+    }
+
+    else{
+      if(rng.index(2)) // Whether to add the bit in the positive or negative cl
+        pos_neg |= bit;
+      else
+        pos |= bit;
+      pos_mix = static_cast<W>(pos | pos_neg);
+      if(pos_mix == max_int)
+        pool.remove(pool_idx, pos_idx);
+    }
+
+    vl[pos_idx] = nat_from_word<T>(pos);
+    vl_neg[pos_idx] = nat_from_word<T>(pos_neg);
+  }
+
+  return res;
+}
+
+// Multiply a velocity by any constant real number. A negative constant swaps
+// the positive and negative parts and a 0 empties the velocity.
+//
+// @return the new total number of operations
+template <typename T, class Rng>
+int nat_scale_vel(double k, T *vl, T *vl_neg, size_t len, int abs_op, int max_size,
+                  Rng &rng, natOpPool &pool){
+  if(k < 0){
+    std::swap_ranges(vl, vl + len, vl_neg);
+    k = -k;
+  }
+
+  if(k == 0){
+    std::fill(vl, vl + len, T());
+    std::fill(vl_neg, vl_neg + len, T());
+    return 0;
+  }
+
+  return nat_cte_times_vel(static_cast<float>(k), vl, vl_neg, len, abs_op, max_size, rng, pool);
+}
+
+// Remove random parents of a node until it has at most max_parents of them
+//
+// @param row the causal units of the node, one per variable in t_0
+// @param n_vars number of variables in t_0
+// @param max_parents maximum number of parents allowed
+// @param rng the source of random numbers
+// @return the number of arcs removed. The row is modified in place.
+template <typename T, class Rng>
+int nat_cap_parents(T *row, int n_vars, int max_parents, Rng &rng){
+  typedef typename natWord<T>::type W;
+  int n_par = 0, removed = 0, idx, j;
+  W unit;
+
+  for(j = 0; j < n_vars; j++)
+    n_par += nat_bitcount(nat_to_word<W>(row[j]));
+
+  for(; n_par > max_parents; n_par--, removed++){
+    // Sample one of the arcs uniformly and find the unit that holds it
+    idx = rng.index(n_par);
+    for(j = 0; idx >= nat_bitcount(unit = nat_to_word<W>(row[j])); j++)
+      idx -= nat_bitcount(unit);
+    nat_clear_bit(unit, nat_select_bit(unit, idx) - 1);
+    row[j] = nat_from_word<T>(unit);
+  }
+
+  return removed;
+}
+
+// Remove the parents of a node that contribute the least to its score until it
+// has at most max_parents of them. Each removal is chosen greedily: every
+// remaining parent is dropped in turn and the one whose absence leaves the
+// best family score is removed. This costs a family score per parent and
+// removal, but only families over the limit pay it.
+//
+// @param row the causal units of the node, one per variable in t_0
+// @param n_vars number of variables in t_0
+// @param max_parents maximum number of parents allowed
+// @param score function that returns the score of the family given its row
+// @return the number of arcs removed. The row is modified in place.
+template <typename T, class Score>
+int nat_prune_parents(T *row, int n_vars, int max_parents, Score score){
+  typedef typename natWord<T>::type W;
+  int n_par = 0, removed = 0, best_j, best_k, k;
+  double best, s;
+  W unit, rest, cand;
+
+  for(int j = 0; j < n_vars; j++)
+    n_par += nat_bitcount(nat_to_word<W>(row[j]));
+
+  for(; n_par > max_parents; n_par--, removed++){
+    best = -INFINITY;
+    best_j = best_k = -1;
+    for(int j = 0; j < n_vars; j++){
+      unit = rest = nat_to_word<W>(row[j]);
+      while(!nat_is_zero(rest)){
+        k = nat_lowest_bit(rest);
+        nat_clear_bit(rest, k);
+        cand = unit;
+        nat_clear_bit(cand, k);
+        row[j] = nat_from_word<T>(cand);
+        s = score(static_cast<const T *>(row));
+        row[j] = nat_from_word<T>(unit);
+        if(best_j < 0 || s > best){
+          best = s;
+          best_j = j;
+          best_k = k;
+        }
+      }
+    }
+    unit = nat_to_word<W>(row[best_j]);
+    nat_clear_bit(unit, best_k);
+    row[best_j] = nat_from_word<T>(unit);
+  }
+
+  return removed;
+}
+
+// Arcs of a position as indexes, without building the names of the nodes
+//
+// @param cl the position's causal list
+// @param n_vars number of variables in t_0
+// @param arcs vector where the arcs are appended as triples of the 0-based
+// parent variable, the time slice of the parent (1 for t_1) and the 0-based
+// child variable in t_0
+template <typename T>
+void nat_cl_to_arcs(const T *cl, int n_vars, std::vector<int> &arcs){
+  typedef typename natWord<T>::type W;
+  W unit;
+  int k;
+
+  for(int i = 0; i < n_vars; i++){
+    for(int j = 0; j < n_vars; j++){
+      unit = nat_to_word<W>(cl[i * n_vars + j]);
+      while(!nat_is_zero(unit)){
+        k = nat_lowest_bit(unit);
+        arcs.push_back(j);
+        arcs.push_back(k + 1);
+        arcs.push_back(i);
+        nat_clear_bit(unit, k);
+      }
+    }
+  }
+}
+
+// Geometric distribution sampler truncated to a maximum. The same as the
+// trunc_geom function in R. Its constants are computed once, so the same
+// sampler can draw many values cheaply.
+class natTruncGeom {
+public:
+  // @param p the parameter of the geometric distribution
+  // @param max the maximum value allowed to be sampled
+  natTruncGeom(double p, double max) : scale(1 - std::pow(1 - p, max)), log_q(std::log(1 - p)){}
+
+  // @param rng the source of random numbers
+  // @return the sampled value
+  template <class Rng>
+  double operator()(Rng &rng) const {
+    return std::floor(std::log(1 - rng.unif01() * scale) / log_q);
+  }
+
+private:
+  double scale, log_q;
+};
+
+// Draw a single value from a truncated geometric distribution, see natTruncGeom
+template <class Rng>
+double nat_trunc_geom(double p, double max, Rng &rng){
+  return natTruncGeom(p, max)(rng);
+}
+
+// Sampler of random causal units for positions and velocities: uniform in
+// [0, 2^bits) if p <= 0, truncated geometric otherwise
+template <typename W>
+class natUnitSampler {
+public:
+  natUnitSampler(double p, int bits) : geom(p > 0 ? p : 0.5, std::ldexp(1.0, bits)), p(p), bits(bits){}
+
+  template <class Rng>
+  W operator()(Rng &rng) const {
+    if(p > 0)
+      return nat_to_word<W>(geom(rng));
+
+    if(bits <= 53)
+      return nat_to_word<W>(std::floor(rng.unif(0, std::ldexp(1.0, bits))));
+
+    // Too many bits for the mantissa of a double, so 32 random bits at a time
+    W res = W();
+    for(int c = 0; c * 32 < bits; c++){
+      uint64_t chunk = static_cast<uint64_t>(rng.unif01() * 4294967296.0);
+      for(int b = 0; b < 32 && c * 32 + b < bits; b++)
+        if((chunk >> b) & 1)
+          res |= natWordOps<W>::bit(c * 32 + b);
+    }
+
+    return res;
+  }
+
+private:
+  natTruncGeom geom;
+  double p;
+  int bits;
+};
+
+// Generate a random position
+//
+// @param cl the position's causal list, filled in place
+// @param len length of the causal list
+// @param max_size maximum number of timeslices of the DBN
+// @param p the parameter of the truncated geometric sampler. If lesser or
+// equal to 0, a uniform distribution is used instead.
+// @param rng the source of random numbers
+// @return the number of arcs of the position
+template <typename T, class Rng>
+int nat_random_position(T *cl, size_t len, int max_size, double p, Rng &rng){
+  typedef typename natWord<T>::type W;
+  natUnitSampler<W> sampler(p, max_size - 1);
+  W unit;
+  int n_arcs = 0;
+
+  for(size_t i = 0; i < len; i++){
+    unit = sampler(rng);
+    cl[i] = nat_from_word<T>(unit);
+    n_arcs += nat_bitcount(unit);
+  }
+
+  return n_arcs;
+}
+
+// Generate a random velocity. Each causal unit is left empty, added to the
+// negative part or added to the positive part with the weights in probs.
+//
+// @param vl the velocity's positive causal list, filled in place
+// @param vl_neg the velocity's negative causal list, filled in place
+// @param len length of the causal lists
+// @param max_size maximum number of timeslices of the DBN
+// @param probs the weights of the operations {-1, 0, 1}
+// @param p the parameter of the truncated geometric sampler
+// @param rng the source of random numbers
+// @return the number of operations of the velocity
+template <typename T, class Rng>
+int nat_random_velocity(T *vl, T *vl_neg, size_t len, int max_size, const double *probs,
+                        double p, Rng &rng){
+  typedef typename natWord<T>::type W;
+  natUnitSampler<W> sampler(p, max_size - 1);
+  W unit;
+  int abs_op = 0, op;
+
+  for(size_t i = 0; i < len; i++){
+    vl[i] = T();
+    vl_neg[i] = T();
+    op = rng.choice(probs, 3);
+    if(op != 1){
+      unit = sampler(rng);
+      if(op == 2)
+        vl[i] = nat_from_word<T>(unit);
+      else
+        vl_neg[i] = nat_from_word<T>(unit);
+      abs_op += nat_bitcount(unit);
+    }
+  }
+
+  return abs_op;
+}
+
+#endif
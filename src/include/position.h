@@ -6,11 +6,15 @@ using namespace Rcpp;
 
 #include "utils.h"
 #include "causality_list.h"
+#include "kernels.h"
 
 #ifndef nat_ps_op
 #define nat_ps_op
-Rcpp::NumericVector create_natcauslist_cpp(Rcpp::NumericVector &cl, Rcpp::List &net, StringVector &ordering);
+Rcpp::NumericVector create_natcauslist_cpp(Rcpp::NumericVector &cl, Rcpp::List &net, StringVector &ordering, int max_size);
+Rcpp::NumericMatrix nat_nets_to_positions_cpp(const Rcpp::List &nets, StringVector &ordering, int max_size);
 Rcpp::CharacterMatrix cl_to_arc_matrix_cpp(const Rcpp::NumericVector &cl, Rcpp::CharacterVector &ordering, unsigned int rows);
 int nat_pos_plus_vel_cpp(Rcpp::NumericVector &cl, const Rcpp::NumericVector &vl, const Rcpp::NumericVector &vl_neg, int n_arcs);
+Rcpp::NumericVector nat_random_position_cpp(int n_vars, int max_size, double p);
+int nat_cap_parents_cpp(Rcpp::NumericVector &cl, int max_parents, int n_arcs);
 #endif
 
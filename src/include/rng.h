@@ -0,0 +1,80 @@
+#ifndef nat_rng_op
+#define nat_rng_op
+
+#include <cstdint>
+
+// Counter-based random number generator
+//
+// The i-th number of a stream is a pure function of its key and of i: the
+// counter is scrambled with the SplitMix64 finalizer. Each stream is defined
+// by a seed and a stream id, so every particle can have its own stream and
+// the draws do not depend on which thread runs it nor on the order in which
+// the particles are processed. The state is just the key and the counter,
+// which makes it trivial to copy or store.
+//
+// All random kernels of the package take an Rng object with this interface:
+// 'index(n)', a uniform integer in [0, n); 'unif01()', a uniform real in
+// [0, 1); 'unif(a, b)', a uniform real in [a, b); and 'choice(probs, k)', an
+// index in [0, k) sampled with the weights in probs.
+class natCounterRng {
+public:
+  natCounterRng(uint64_t seed = 0, uint64_t stream = 0) : key(mix(seed ^ mix(stream + gamma))), ctr(0){}
+
+  uint64_t next(){
+    return mix(key + (ctr++) * gamma);
+  }
+
+  // Uniform real in [0, 1) with 53 random bits
+  double unif01(){
+    return (next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  double unif(double a, double b){
+    return a + (b - a) * unif01();
+  }
+
+  int index(int n){
+    return static_cast<int>(n * unif01());
+  }
+
+  // Sample an index with probability proportional to its weight
+  //
+  // @param probs the non-negative weights
+  // @param k the number of weights
+  int choice(const double *probs, int k){
+    double total = 0, u;
+
+    for(int i = 0; i < k; i++)
+      total += probs[i];
+    u = unif01() * total;
+    for(int i = 0; i < k - 1; i++){
+      if(u < probs[i])
+        return i;
+      u -= probs[i];
+    }
+
+    return k - 1;
+  }
+
+  uint64_t get_counter() const {return ctr;}
+
+  void set_counter(uint64_t c){ctr = c;}
+
+  // The key identifies the stream. Together with the counter, it is the whole
+  // state of the generator.
+  uint64_t get_key() const {return key;}
+
+  void set_key(uint64_t k){key = k;}
+
+private:
+  static const uint64_t gamma = 0x9E3779B97F4A7C15ULL;
+  uint64_t key, ctr;
+
+  static uint64_t mix(uint64_t z){
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+};
+
+#endif
@@ -0,0 +1,638 @@
+#ifndef nat_score_op
+#define nat_score_op
+
+#include <vector>
+#include <cmath>
+#include <memory>
+#include "family_cache.h"
+#include "score_store.h"
+#include "suff_stats.h"
+#include "discrete.h"
+
+// Cholesky factor of the submatrix of some columns of a symmetric positive
+// definite matrix
+//
+// The factor is stored by rows and packed, so the row r holds its r + 1
+// elements. Each row only depends on the rows above it. When the factor is
+// set to new columns, it keeps the rows of the columns before the first
+// difference and only computes the rest. A family that gains or loses its
+// last parent costs O(k^2) instead of O(k^3). The kept rows are exactly the
+// ones that a full decomposition would compute, so the factor is the same bit
+// for bit whatever columns were factored before.
+class natCholFactor {
+public:
+  // Factor the submatrix of the columns cols, in that order
+  //
+  // @param cols the columns
+  // @param n number of columns
+  // @param m the element (i, j) of the matrix
+  // @return false if the submatrix is not positive definite
+  template <class M>
+  bool set_columns(const int *cols, int n, M m){
+    int keep = 0;
+
+    while(keep < n && keep < (int)this->cols.size() && this->cols[keep] == cols[keep])
+      keep++;
+    truncate(keep);
+    for(int r = keep; r < n; r++){
+      double acc = next_row(cols[r], m);
+      if(acc <= 0)
+        return false;
+      acc = std::sqrt(acc);
+      l.insert(l.end(), w.begin(), w.end());
+      l.push_back(acc);
+      log_det_rows.push_back(log_det() + 2 * std::log(acc));
+      this->cols.push_back(cols[r]);
+    }
+
+    return true;
+  }
+
+  // Logarithm of the determinant of the submatrix
+  double log_det() const {return log_det_rows.empty() ? 0 : log_det_rows.back();}
+
+  // Logarithm of the square of the pivot that the column c would have after
+  // the columns of the factor, which is the variance of c that they do not
+  // explain. The determinant of the submatrix with c is the one without it
+  // times the square of the pivot. The factor does not change.
+  //
+  // @return the logarithm, or NaN if the submatrix with c is not positive definite
+  template <class M>
+  double log_pivot(int c, M m){
+    double acc = next_row(c, m);
+
+    return acc > 0 ? std::log(acc) : NAN;
+  }
+
+  int get_size() const {return cols.size();}
+
+private:
+  std::vector<int> cols;
+  std::vector<double> l, log_det_rows, w;
+
+  void truncate(int n){
+    cols.resize(n);
+    l.resize((size_t)n * (n + 1) / 2);
+    log_det_rows.resize(n);
+  }
+
+  // Fill w with the off-diagonal elements of the row of the column c below
+  // the factor and return the square of its diagonal element
+  template <class M>
+  double next_row(int c, M m){
+    int k = cols.size();
+    double acc = m(c, c);
+
+    w.resize(k);
+    for(int q = 0; q < k; q++){
+      const double *row_q = &l[(size_t)q * (q + 1) / 2];
+      double v = m(c, cols[q]);
+      for(int p = 0; p < q; p++)
+        v -= w[p] * row_q[p];
+      w[q] = v / row_q[q];
+    }
+    for(int p = 0; p < k; p++)
+      acc -= w[p] * w[p];
+
+    return acc;
+  }
+};
+
+// Work buffers of a family score computation. Each thread that scores
+// families at the same time needs its own.
+struct natScoreBuffers {
+  std::vector<int> fam;
+  std::vector<unsigned int> key;
+  natCholFactor chol;
+  natCountBuffers counts;
+  size_t hits = 0; // Cache hits of the families scored with these buffers
+};
+
+// Interface of the scorers for the parts of the package that do not know
+// which score is in use: the R functions and the creation of the swarms. The
+// swarms are then built for the concrete type of the scorer, so scoring a
+// family is never a virtual call.
+class natScoreBase {
+public:
+  virtual ~natScoreBase(){}
+  // Score of a whole position stored as doubles, as R does
+  virtual double score_cl(const double *cl) = 0;
+  // Local score of a node given the parents encoded in its row
+  virtual double node_score(int node, const uint64_t *row) = 0;
+  virtual int get_n_vars() const = 0;
+  virtual int get_max_size() const = 0;
+  virtual natFamilyCache& get_cache() = 0;
+  // Name of the score, as it is chosen from R
+  virtual const char* get_name() const = 0;
+  // Fingerprint of the dataset and the parameters of the score
+  virtual uint64_t get_fingerprint() const = 0;
+  // Persistent store of family scores shared by the scorer and its clones
+  virtual void set_store(std::shared_ptr<natScoreStore> store) = 0;
+  virtual natScoreStore* get_store() = 0;
+};
+
+// Native scorer of natural causal lists for a decomposable score
+//
+// The score of a position is the sum of the local score of each node in t_0
+// given its parents. The family of the node i is fully defined by its row of
+// the causal list, cl[i * n_vars + j] for j in [0, n_vars), where each bit
+// k - 1 of the word means an arc from the variable j in t_k. The rows can be
+// stored in any of the word types of words.h. This class stays free of Rcpp
+// types so that it can be used from any native part of the package.
+//
+// The score itself is the Policy, which is fixed at compile time. It receives
+// the columns of a family, the node first and then its parents, where the
+// column k * n_vars + j is the variable j in the time slice k, and returns
+// its local score:
+//
+//   double family(const int *fam, int l, natScoreBuffers &buf, natCholFactor *factor) const;
+//
+// The factor, if not null, is the one that the caller keeps for this node and
+// that the policy may reuse from the last family it scored there. Otherwise,
+// the policy uses the one in buf.
+//
+// It also tells the number of variables and time slices, the name of the
+// score and the fingerprint of its dataset and parameters, and it has to be
+// cheap to copy, sharing its statistics. Family scores are memoized in a
+// bounded cache, so only families that have not been seen recently are
+// recomputed. The families missing from the cache are looked up in the
+// persistent store, if there is one, before computing them, and the new ones
+// are added to it.
+//
+// The family_score overload that receives its own natScoreBuffers can be
+// called from several threads at once. The rest of the methods use the
+// buffers of the object and are not thread safe.
+template <class Policy>
+class natScore final : public natScoreBase {
+public:
+  // @param policy the score and the statistics of the dataset
+  // @param cache_size maximum number of family scores kept in the cache
+  natScore(const Policy &policy, size_t cache_size) :
+    policy(policy), n_vars(policy.get_n_vars()), max_size(policy.get_max_size()),
+    row_buf(n_vars), cache(n_vars, cache_size, max_size){}
+
+  // Local score of a node given the parents encoded in its row of the causal list
+  //
+  // @param node index of the node in t_0
+  // @param row pointer to the n_vars words that define its parents
+  // @param buf the work buffers of the calling thread
+  // @param factor the factor of the last family scored for this node by the
+  // caller, if it keeps one, which is updated to the new one
+  // @return the score of the family
+  template <typename W>
+  double family_score(int node, const W *row, natScoreBuffers &buf, natCholFactor *factor = nullptr){
+    double res;
+
+    if(cache.find(node, row, res, buf.key))
+      buf.hits++;
+    else{
+      if(!store || !store->find(buf.key, res)){
+        int l = family_columns(node, row, buf.fam);
+        res = policy.family(buf.fam.data(), l, buf, factor);
+        if(store)
+          store->add(buf.key, res);
+      }
+      cache.insert(node, row, res, buf.key);
+    }
+
+    return res;
+  }
+
+  template <typename W>
+  double family_score(int node, const W *row){
+    return family_score(node, row, own_buf);
+  }
+
+  // Score of a whole position. It only needs the n_vars * n_vars causal list.
+  //
+  // @param cl the causal list of the position
+  // @return the score of the network
+  template <typename T>
+  double score(const T *cl){
+    double res = 0;
+
+    for(int i = 0; i < n_vars; i++)
+      res += family_score(i, row_of(cl + i * n_vars));
+
+    return res;
+  }
+
+  double score_cl(const double *cl){return score(cl);}
+
+  double node_score(int node, const uint64_t *row){return family_score(node, row);}
+
+  // New scorer of the same statistics with its own empty cache. The statistics
+  // and the persistent store are shared, not copied.
+  //
+  // @param cache_size maximum number of family scores kept in the new cache
+  natScore* clone(size_t cache_size) const {
+    natScore *res = new natScore(policy, cache_size);
+    res->store = store;
+    return res;
+  }
+
+  int get_n_vars() const {return n_vars;}
+
+  int get_max_size() const {return max_size;}
+
+  natFamilyCache& get_cache() {return cache;}
+
+  const char* get_name() const {return policy.get_name();}
+
+  uint64_t get_fingerprint() const {return policy.get_fingerprint();}
+
+  void set_store(std::shared_ptr<natScoreStore> store){this->store = store;}
+
+  natScoreStore* get_store() {return store.get();}
+
+private:
+  Policy policy;
+  int n_vars, max_size;
+  std::vector<uint64_t> row_buf;
+  natScoreBuffers own_buf;
+  natFamilyCache cache;
+  std::shared_ptr<natScoreStore> store;
+
+  // Rows of the causal lists stored as words can be used as they are, while
+  // the ones stored as doubles by R are converted into row_buf
+  template <typename W>
+  const W* row_of(const W *row){return row;}
+
+  const uint64_t* row_of(const double *row){
+    for(int j = 0; j < n_vars; j++)
+      row_buf[j] = static_cast<uint64_t>(row[j]);
+    return row_buf.data();
+  }
+
+  // Fill fam with the column of the node in t_0 followed by the columns of
+  // its parents. Bit k - 1 of row[j] means an arc from the variable j in t_k.
+  template <typename W>
+  int family_columns(int node, const W *row, std::vector<int> &fam){
+    int l = 0, k;
+    W slice;
+
+    fam.resize(n_vars * max_size + 1);
+    fam[l++] = node;
+    for(int j = 0; j < n_vars; j++){
+      slice = row[j];
+      while(!nat_is_zero(slice)){
+        k = nat_lowest_bit(slice) + 1;
+        if(k >= max_size)
+          break;
+        fam[l++] = k * n_vars + j;
+        nat_clear_bit(slice, k - 1);
+      }
+    }
+
+    return l;
+  }
+};
+
+// Add the statistics that the Gaussian scores use to a fingerprint
+inline void nat_fingerprint_stats(natFingerprint &fp, const natSuffStats &stats){
+  fp.add('g');
+  fp.add((uint64_t)stats.get_n());
+  for(int i = 0; i < stats.get_n_cols(); i++)
+    for(int j = 0; j <= i; j++)
+      fp.add(stats.get_scatter(i, j));
+}
+
+// BGe score
+//
+// The formula is the one from Kuipers, Moffa and Heckerman (2014), which is
+// the one that bnlearn uses with its default hyperparameters: iss_mu = 1,
+// iss_w = n_cols + 2, the prior mean set to the sample mean and the prior
+// matrix T = t * I with t = iss_mu * (iss_w - n_cols - 1) / (iss_mu + 1).
+//
+// The score never sees the dataset. It works with the sufficient statistics
+// of the folded columns, stored in the order k * n_vars + j for the variable
+// j in the time slice k, so the cost of a family only depends on its size.
+class natBgePolicy {
+public:
+  // @param stats the sufficient statistics of the folded columns
+  // @param n_cols total number of nodes in the network
+  // @param n_vars number of variables in t_0
+  // @param max_size maximum number of timeslices of the DBN
+  // @param iss_mu imaginary sample size for the prior of the mean
+  // @param iss_w imaginary sample size for the prior of the precision matrix
+  natBgePolicy(std::shared_ptr<const natSuffStats> stats, int n_cols, int n_vars, int max_size,
+               double iss_mu, double iss_w) :
+    n_cols(n_cols), n_vars(n_vars), max_size(max_size), iss_mu(iss_mu), iss_w(iss_w), stats(stats){
+    t = iss_mu * (iss_w - n_cols - 1) / (iss_mu + 1);
+    n_rows = stats->get_n();
+    init_subset_consts();
+  }
+
+  // The parents are factored first, so the factor of the whole family only
+  // needs one more row
+  double family(const int *fam, int l, natScoreBuffers &buf, natCholFactor *factor) const {
+    natCholFactor &chol = factor ? *factor : buf.chol;
+    auto m = [this](int i, int j){return stats->get_scatter(i, j) + (i == j ? t : 0);};
+
+    if(!chol.set_columns(fam + 1, l - 1, m))
+      return NAN;
+    double log_det_pa = chol.log_det();
+
+    return subset_score(l, log_det_pa + chol.log_pivot(fam[0], m)) - subset_score(l - 1, log_det_pa);
+  }
+
+  int get_n_vars() const {return n_vars;}
+
+  int get_max_size() const {return max_size;}
+
+  const char* get_name() const {return "bge";}
+
+  uint64_t get_fingerprint() const {
+    natFingerprint res;
+    res.add(n_cols);
+    res.add(n_vars);
+    res.add(max_size);
+    res.add(iss_mu);
+    res.add(iss_w);
+    nat_fingerprint_stats(res, *stats);
+    return res.get();
+  }
+
+private:
+  int n_cols, n_vars, max_size;
+  double n_rows, iss_mu, iss_w, t;
+  std::shared_ptr<const natSuffStats> stats;
+  // Terms of the subset score that only depend on its size. They are shared
+  // by the copies of the policy.
+  std::shared_ptr<std::vector<double>> subset_const;
+
+  // Logarithm of the multivariate gamma function of dimension l
+  double log_mvgamma(double a, int l) const {
+    double res = l * (l - 1) / 4.0 * std::log(M_PI);
+    for(int j = 1; j <= l; j++)
+      res += std::lgamma(a + (1 - j) / 2.0);
+
+    return res;
+  }
+
+  // Precalculate the terms of the subset scores that do not depend on the
+  // data of the subset, for every possible size. It also keeps lgamma, which
+  // is not thread safe, out of the scoring of the families.
+  void init_subset_consts(){
+    int max_l = n_vars * max_size + 1;
+    double a_post, a_prior;
+
+    subset_const = std::make_shared<std::vector<double>>(max_l + 1, 0);
+    std::vector<double> &c = *subset_const;
+    for(int l = 1; l <= max_l; l++){
+      a_prior = (iss_w - n_cols + l) / 2.0;
+      a_post = (n_rows + iss_w - n_cols + l) / 2.0;
+      c[l] = -l * n_rows / 2.0 * std::log(M_PI);
+      c[l] += l / 2.0 * std::log(iss_mu / (n_rows + iss_mu));
+      c[l] += log_mvgamma(a_post, l) - log_mvgamma(a_prior, l);
+      c[l] += a_prior * l * std::log(t);
+    }
+  }
+
+  // Logarithm of the marginal likelihood of a subset of l columns, given the
+  // log determinant of their scatter submatrix plus the prior matrix T. The
+  // score of a family is the difference between the one of the whole family
+  // and the one of its parents.
+  double subset_score(int l, double log_det) const {
+    if(l == 0)
+      return 0;
+
+    double a_post = (n_rows + iss_w - n_cols + l) / 2.0;
+
+    return (*subset_const)[l] - a_post * log_det;
+  }
+};
+
+// Penalties of the Gaussian likelihood scores
+enum natLikPenalty {NAT_PENALTY_NONE, NAT_PENALTY_AIC, NAT_PENALTY_BIC};
+
+// Gaussian log-likelihood, BIC and AIC scores
+//
+// The local score is the log-likelihood of the linear regression of the node
+// on its parents with the maximum likelihood estimates, as logLik of lm,
+// minus a penalty per parameter: 0 for the log-likelihood, 1 for AIC and
+// log(n) / 2 for BIC. The parameters are the intercept, one coefficient per
+// parent and the variance. The scores are scaled so that higher is better,
+// so BIC and AIC are -1/2 times the usual ones.
+//
+// The residual sum of squares is the square of the last diagonal element of
+// the Cholesky factor of the scatter matrix of the family ordered with the
+// node last, so it only needs the factor of the parents.
+class natGaussLikPolicy {
+public:
+  // @param stats the sufficient statistics of the folded columns
+  // @param n_vars number of variables in t_0
+  // @param max_size maximum number of timeslices of the DBN
+  // @param penalty the penalty of the number of parameters
+  natGaussLikPolicy(std::shared_ptr<const natSuffStats> stats, int n_vars, int max_size, natLikPenalty penalty) :
+    n_vars(n_vars), max_size(max_size), penalty(penalty), stats(stats){
+    n_rows = stats->get_n();
+    if(penalty == NAT_PENALTY_BIC)
+      per_param = std::log(n_rows) / 2;
+    else
+      per_param = penalty == NAT_PENALTY_AIC ? 1 : 0;
+    lik_const = -n_rows / 2 * (std::log(2 * M_PI) + 1 - std::log(n_rows));
+  }
+
+  double family(const int *fam, int l, natScoreBuffers &buf, natCholFactor *factor) const {
+    natCholFactor &chol = factor ? *factor : buf.chol;
+    auto m = [this](int i, int j){return stats->get_scatter(i, j);};
+
+    if(!chol.set_columns(fam + 1, l - 1, m))
+      return NAN;
+    double log_rss = chol.log_pivot(fam[0], m);
+
+    return lik_const - n_rows / 2 * log_rss - per_param * (l + 1);
+  }
+
+  int get_n_vars() const {return n_vars;}
+
+  int get_max_size() const {return max_size;}
+
+  const char* get_name() const {
+    return penalty == NAT_PENALTY_BIC ? "bic" : penalty == NAT_PENALTY_AIC ? "aic" : "loglik";
+  }
+
+  uint64_t get_fingerprint() const {
+    natFingerprint res;
+    res.add(n_vars);
+    res.add(max_size);
+    nat_fingerprint_stats(res, *stats);
+    return res.get();
+  }
+
+private:
+  int n_vars, max_size;
+  natLikPenalty penalty;
+  double n_rows, per_param, lik_const;
+  std::shared_ptr<const natSuffStats> stats;
+};
+
+// Scores of discrete datasets
+enum natDiscreteKind {NAT_DISCRETE_BDE, NAT_DISCRETE_BIC, NAT_DISCRETE_AIC, NAT_DISCRETE_LOGLIK};
+
+// BDeu, BIC, AIC and log-likelihood scores of discrete data
+//
+// The local scores are the ones of bnlearn for multinomial networks: BDeu
+// with an imaginary sample size iss spread uniformly over the q parent
+// configurations and the r levels of the node, and the log-likelihood with
+// the maximum likelihood estimates minus a penalty per parameter, of which
+// there are (r - 1) * q. As in natGaussLikPolicy, BIC and AIC are -1/2 times
+// the usual ones, so higher is better.
+//
+// Both only need the counts of the non-empty cells of the contingency table
+// of the family. The configurations of the parents are taken from a cache
+// shared by the copies of the policy. On a miss, the configurations of a
+// cached set with one parent less are extended with the missing parent,
+// which costs a single pass over the rows. Only when none is cached are the
+// codes of all the parents packed into one integer key per row, in mixed
+// radix, and numbered with a table or a radix sort.
+class natDiscretePolicy {
+public:
+  // @param data the encoded folded columns
+  // @param n_vars number of variables in t_0
+  // @param max_size maximum number of timeslices of the DBN
+  // @param kind the score
+  // @param iss imaginary sample size of BDeu
+  // @param count_cache memory in bytes of the cache of parent configurations
+  natDiscretePolicy(std::shared_ptr<const natCodedData> data, int n_vars, int max_size,
+                    natDiscreteKind kind, double iss, size_t count_cache) :
+    n_vars(n_vars), max_size(max_size), kind(kind), iss(iss), data(data){
+    double n_rows = data->get_n();
+
+    per_param = kind == NAT_DISCRETE_BIC ? std::log(n_rows) / 2 : kind == NAT_DISCRETE_AIC ? 1 : 0;
+    configs = std::make_shared<natConfigCache>(count_cache);
+    std::shared_ptr<natParentConfigs> empty = std::make_shared<natParentConfigs>();
+    empty->ids.assign(data->get_n(), 0);
+    empty->counts.assign(1, data->get_n());
+    no_parents = empty;
+  }
+
+  double family(const int *fam, int l, natScoreBuffers &buf, natCholFactor *) const {
+    std::shared_ptr<const natParentConfigs> pa = parent_configs(fam + 1, l - 1, buf.counts);
+    int r = data->get_levels(fam[0]);
+    double q = 1, res = 0;
+
+    for(int i = 1; i < l; i++)
+      q *= data->get_levels(fam[i]);
+
+    if(kind == NAT_DISCRETE_BDE){
+      double a_j = iss / q, a_jk = a_j / r;
+
+      for(uint32_t n_j : pa->counts)
+        res -= nat_log_rising(a_j, n_j);
+      nat_family_counts(*pa, data->get_column(fam[0]), r, buf.counts, [&](uint64_t, uint32_t n_jk){
+        res += nat_log_rising(a_jk, n_jk);
+      });
+    }
+    else{
+      for(uint32_t n_j : pa->counts)
+        res -= n_j * std::log((double)n_j);
+      nat_family_counts(*pa, data->get_column(fam[0]), r, buf.counts, [&](uint64_t, uint32_t n_jk){
+        res += n_jk * std::log((double)n_jk);
+      });
+      res -= per_param * (r - 1) * q;
+    }
+
+    return res;
+  }
+
+  int get_n_vars() const {return n_vars;}
+
+  int get_max_size() const {return max_size;}
+
+  const char* get_name() const {
+    const char *names[] = {"bde", "bic", "aic", "loglik"};
+    return names[kind];
+  }
+
+  uint64_t get_fingerprint() const {
+    natFingerprint res;
+    res.add('d');
+    res.add(n_vars);
+    res.add(max_size);
+    res.add(iss);
+    res.add((uint64_t)data->get_n());
+    for(int i = 0; i < data->get_n_cols(); i++){
+      res.add(data->get_levels(i));
+      res.add(data->get_column(i), data->get_n());
+    }
+    return res.get();
+  }
+
+private:
+  int n_vars, max_size;
+  natDiscreteKind kind;
+  double iss, per_param;
+  std::shared_ptr<const natCodedData> data;
+  std::shared_ptr<natConfigCache> configs;
+  std::shared_ptr<const natParentConfigs> no_parents;
+
+  // Largest mixed radix key before the partial keys are renumbered
+  static const uint64_t max_key = (uint64_t)1 << 40;
+
+  // Configurations of the parents in the columns pa
+  std::shared_ptr<const natParentConfigs> parent_configs(const int *pa, int m, natCountBuffers &buf) const {
+    std::vector<unsigned int> &key = buf.pa_key;
+    std::shared_ptr<const natParentConfigs> sub;
+    std::shared_ptr<natParentConfigs> res;
+    size_t n = data->get_n();
+
+    if(m == 0)
+      return no_parents;
+    key.assign(pa, pa + m);
+    if((sub = configs->find(key)))
+      return sub;
+
+    // A cached set with one parent less, or none for a single parent
+    int missing = 0;
+    if(m == 1)
+      sub = no_parents;
+    for(int i = 0; i < m && !sub; i++){
+      key.assign(pa, pa + m);
+      key.erase(key.begin() + i);
+      missing = i;
+      sub = configs->find(key);
+    }
+
+    res = std::make_shared<natParentConfigs>();
+    std::vector<uint64_t> &keys = buf.keys;
+    keys.resize(n);
+    uint64_t n_keys;
+    if(sub){
+      const uint8_t *col = data->get_column(pa[missing]);
+      uint64_t lv = data->get_levels(pa[missing]);
+      for(size_t r = 0; r < n; r++)
+        keys[r] = sub->ids[r] * lv + col[r];
+      n_keys = sub->counts.size() * lv;
+    }
+    else{
+      std::fill(keys.begin(), keys.end(), 0);
+      n_keys = 1;
+      for(int i = 0; i < m; i++){
+        const uint8_t *col = data->get_column(pa[i]);
+        uint64_t lv = data->get_levels(pa[i]);
+        if(n_keys * lv > max_key){
+          nat_dense_ids(keys, n_keys, *res, buf);
+          std::copy(res->ids.begin(), res->ids.end(), keys.begin());
+          n_keys = res->counts.size();
+        }
+        for(size_t r = 0; r < n; r++)
+          keys[r] = keys[r] * lv + col[r];
+        n_keys *= lv;
+      }
+    }
+    nat_dense_ids(keys, n_keys, *res, buf);
+
+    key.assign(pa, pa + m);
+    configs->insert(key, res);
+
+    return res;
+  }
+};
+
+typedef natScore<natBgePolicy> natBgeScore;
+typedef natScore<natGaussLikPolicy> natGaussLikScore;
+typedef natScore<natDiscretePolicy> natDiscreteScore;
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef Rcpp_head
+#define Rcpp_head
+#include <Rcpp.h>
+using namespace Rcpp;
+#endif
+
+#include "score.h"
+#include "columnar.h"
+
+#ifndef nat_score_r_op
+#define nat_score_r_op
+natScoreBase* nat_new_gaussian_scorer(std::shared_ptr<const natSuffStats> stats, int n_cols, int n_vars, int max_size, double iss_mu, double iss_w, double cache_size, const std::string &score);
+natScoreBase* nat_new_discrete_scorer(std::shared_ptr<const natCodedData> data, int n_vars, int max_size, double iss, double cache_size, double count_cache, const std::string &score);
+std::vector<int> nat_coded_levels(const Rcpp::IntegerVector &levels, const std::vector<int> &cols);
+SEXP create_gaussian_scorer_cpp(const Rcpp::List &dt, const Rcpp::IntegerMatrix &col_idx, double iss_mu, double iss_w, double cache_size, std::string score);
+SEXP create_gaussian_scorer_raw_cpp(const Rcpp::List &dt, const Rcpp::IntegerVector &var_idx, const Rcpp::IntegerVector &id, int max_size, double iss_mu, double iss_w, double cache_size, std::string score);
+SEXP create_gaussian_scorer_file_cpp(std::string file, const Rcpp::IntegerMatrix &col_idx, double iss_mu, double iss_w, double cache_size, int n_threads, std::string score);
+SEXP create_discrete_scorer_cpp(const Rcpp::List &dt, const Rcpp::IntegerVector &levels, const Rcpp::IntegerMatrix &col_idx, double iss, double cache_size, double count_cache, std::string score);
+SEXP create_discrete_scorer_raw_cpp(const Rcpp::List &dt, const Rcpp::IntegerVector &var_idx, const Rcpp::IntegerVector &id, const Rcpp::IntegerVector &levels, int max_size, double iss, double cache_size, double count_cache, std::string score);
+double nat_score_cpp(SEXP scorer, const Rcpp::NumericVector &cl);
+Rcpp::NumericVector nat_family_scores_cpp(SEXP scorer, const Rcpp::NumericVector &cl);
+Rcpp::List nat_cache_stats_cpp(SEXP scorer);
+Rcpp::List nat_cache_stats_list(const natCacheStats &stats, const natScoreStore *store);
+std::string nat_open_score_store_cpp(SEXP scorer, std::string dir);
+void nat_flush_score_store_cpp(SEXP scorer);
+#endif
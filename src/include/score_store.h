@@ -0,0 +1,426 @@
+#ifndef nat_score_store_op
+#define nat_score_store_op
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include "family_cache.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// 64 bit fingerprint of the data and parameters that define a score. FNV-1a
+// over 64 bit words, so that hashing a large dataset costs about as much as
+// reading it once.
+class natFingerprint {
+public:
+  void add(const void *data, size_t len){
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    uint64_t w;
+
+    for(; len >= 8; p += 8, len -= 8){
+      std::memcpy(&w, p, 8);
+      mix(w);
+    }
+    for(; len > 0; p++, len--)
+      mix(*p);
+  }
+
+  template <typename T>
+  void add(T x){add(&x, sizeof(T));}
+
+  uint64_t get() const {return h;}
+
+private:
+  uint64_t h = 14695981039346656037ULL;
+
+  void mix(uint64_t w){
+    h ^= w;
+    h *= 1099511628211ULL;
+  }
+};
+
+// Persistent store of family scores
+//
+// A file that keeps the family scores computed on a dataset with a score, so
+// that later runs on the same dataset start with them. The name of the file
+// is the name of the score followed by the fingerprint of the dataset and the
+// parameters of the score, so a directory can hold the stores of several
+// datasets and scores, and a store is never used with the wrong ones.
+//
+// The scores already in the file are mapped in memory when it is opened and
+// indexed in a hash table of their offsets, so they are looked up in place
+// without being read into memory first. New scores are kept in a buffer and
+// appended in batches. Several runs, in the same or in different processes,
+// can append to the same file: each batch is written under an exclusive lock
+// of the file, and a record left incomplete by a run that crashed is padded
+// before the next batch. Every record carries a checksum, so damaged ones are
+// ignored. Scores appended by other runs after the file was opened are not
+// seen until it is opened again.
+//
+// Layout, with all integers in the byte order of the machine:
+//   magic "NATFSC1" plus a 0 byte
+//   uint32 number of words of the family keys, uint32 0
+//   uint64 fingerprint
+//   the name of the score, padded with 0 bytes to 16 bytes
+//   records: the words of the key, padded to a multiple of 8 bytes, the score
+//   as a double and the checksum of both as an uint64
+//
+// Lookups can be done from several threads at the same time. Adding scores is
+// also thread safe.
+
+const char NAT_FSC_MAGIC[8] = {'N', 'A', 'T', 'F', 'S', 'C', '1', '\0'};
+const size_t NAT_FSC_HEADER = 40;
+
+class natScoreStore {
+public:
+  natScoreStore(){}
+  natScoreStore(const natScoreStore &) = delete;
+  natScoreStore& operator=(const natScoreStore &) = delete;
+
+  ~natScoreStore(){
+    flush();
+    unmap();
+    close_file();
+  }
+
+  // Open the store of a dataset and score in a directory, creating it if it
+  // does not exist
+  //
+  // @param dir the directory of the stores
+  // @param name the name of the score, of at most 16 characters
+  // @param fingerprint the fingerprint of the dataset and the parameters of the score
+  // @param key_len the number of words of the family keys
+  // @param err the message of the error, if any
+  // @return whether the store was opened
+  bool open(const std::string &dir, const std::string &name, uint64_t fingerprint, size_t key_len, std::string &err){
+    char fp[17];
+    char header[NAT_FSC_HEADER] = {0}, file_header[NAT_FSC_HEADER];
+    uint32_t words = key_len;
+    uint64_t size;
+    bool ok;
+
+    this->key_len = key_len;
+    rec_size = (key_len * sizeof(uint32_t) + 7) / 8 * 8 + 16;
+    std::snprintf(fp, sizeof(fp), "%016llx", (unsigned long long)fingerprint);
+    path = dir + "/" + name + "_" + fp + ".natfsc";
+
+    std::memcpy(header, NAT_FSC_MAGIC, 8);
+    std::memcpy(header + 8, &words, sizeof(uint32_t));
+    std::memcpy(header + 16, &fingerprint, sizeof(uint64_t));
+    std::memcpy(header + 24, name.data(), std::min<size_t>(name.size(), 16));
+
+    if(!open_file()){
+      err = "Cannot open the score cache " + path + ".";
+      return false;
+    }
+    // The first run writes the header. The lock keeps the others from reading
+    // it before it is complete.
+    lock();
+    ok = file_size(size);
+    if(ok && size == 0)
+      ok = append(header, NAT_FSC_HEADER) && file_size(size);
+    ok = ok && size >= NAT_FSC_HEADER && read_header(file_header);
+    unlock();
+    if(!ok || std::memcmp(header, file_header, NAT_FSC_HEADER) != 0){
+      err = "The file " + path + " is not a score cache of this dataset and score.";
+      close_file();
+      return false;
+    }
+
+    n_records = (size - NAT_FSC_HEADER) / rec_size;
+    if(n_records > 0 && !map(NAT_FSC_HEADER + n_records * rec_size)){
+      err = "Cannot map the score cache " + path + ".";
+      close_file();
+      return false;
+    }
+    build_index();
+
+    return true;
+  }
+
+  // Look for the score of a family
+  //
+  // @param key the key of the family, as natFamilyCache builds it
+  // @param score where the score is returned
+  // @return whether the family was found
+  bool find(const std::vector<unsigned int> &key, double &score) const {
+    if(index.empty())
+      return false;
+
+    size_t mask = index.size() - 1;
+    for(size_t s = natFamilyKeyHash()(key.data(), key_len) & mask; index[s]; s = (s + 1) & mask){
+      const char *rec = data + index[s];
+      if(std::memcmp(rec, key.data(), key_len * sizeof(uint32_t)) == 0){
+        std::memcpy(&score, rec + rec_size - 16, sizeof(double));
+        hits++;
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // Add the score of a family that is not in the store. It is written to the
+  // file with the next batch.
+  void add(const std::vector<unsigned int> &key, double score){
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t pos = pending.size();
+    uint64_t check = checksum(key.data(), score);
+
+    pending.resize(pos + rec_size, 0);
+    std::memcpy(&pending[pos], key.data(), key_len * sizeof(uint32_t));
+    std::memcpy(&pending[pos + rec_size - 16], &score, sizeof(double));
+    std::memcpy(&pending[pos + rec_size - 8], &check, sizeof(uint64_t));
+    n_added++;
+    if(pending.size() >= batch_bytes)
+      write_pending();
+  }
+
+  // Append the scores added since the last batch to the file
+  //
+  // @return whether they were written, and so were the batches written by
+  // add since the last flush. The scores of a batch that failed are lost.
+  bool flush(){
+    std::lock_guard<std::mutex> lock(mtx);
+    bool ok = write_pending() && !failed;
+
+    failed = false;
+    return ok;
+  }
+
+  const std::string& get_path() const {return path;}
+
+  // Number of scores that were in the file when it was opened
+  size_t get_size() const {return n_records;}
+
+  size_t get_hits() const {return hits;}
+
+  // Number of scores added by this run
+  size_t get_added() const {return n_added;}
+
+private:
+  static const size_t batch_bytes = 1 << 20;
+
+  std::string path;
+  size_t key_len = 0, rec_size = 0, n_records = 0, n_added = 0;
+  bool failed = false; // Whether a batch could not be written since the last flush
+  const char *data = nullptr;
+  size_t size = 0;
+  std::vector<uint64_t> index; // Offset of a record in each slot, 0 if it is empty
+  std::vector<char> pending;
+  std::mutex mtx;
+  mutable std::atomic<size_t> hits{0};
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE, mapping = NULL;
+#else
+  int fd = -1;
+#endif
+
+  uint64_t checksum(const unsigned int *key, double score) const {
+    natFingerprint res;
+    res.add(key, key_len * sizeof(uint32_t));
+    res.add(score);
+    return res.get();
+  }
+
+  // Index the complete and valid records of the mapped file. The first copy
+  // of a family is kept, as concurrent runs may have added it more than once.
+  void build_index(){
+    size_t slots = 16;
+    double score;
+    uint64_t check;
+
+    if(n_records == 0)
+      return;
+    while(slots < 2 * n_records)
+      slots *= 2;
+    index.assign(slots, 0);
+    for(size_t r = 0; r < n_records; r++){
+      uint64_t pos = NAT_FSC_HEADER + r * rec_size;
+      const char *rec = data + pos;
+      const unsigned int *key = reinterpret_cast<const unsigned int *>(rec);
+      std::memcpy(&score, rec + rec_size - 16, sizeof(double));
+      std::memcpy(&check, rec + rec_size - 8, sizeof(uint64_t));
+      if(check != checksum(key, score))
+        continue;
+      size_t s = natFamilyKeyHash()(key, key_len) & (slots - 1);
+      while(index[s] && std::memcmp(data + index[s], rec, key_len * sizeof(uint32_t)) != 0)
+        s = (s + 1) & (slots - 1);
+      if(!index[s])
+        index[s] = pos;
+    }
+  }
+
+  // Write the pending records with the file locked. An incomplete record at
+  // the end of the file is padded first, so the new ones stay aligned.
+  bool write_pending(){
+    uint64_t size;
+    bool ok;
+
+    if(pending.empty() || !is_open())
+      return true;
+    lock();
+    ok = file_size(size);
+    if(ok && (size - NAT_FSC_HEADER) % rec_size != 0){
+      std::vector<char> pad(rec_size - (size - NAT_FSC_HEADER) % rec_size, 0);
+      ok = append(pad.data(), pad.size());
+    }
+    ok = ok && append(pending.data(), pending.size());
+    unlock();
+    pending.clear();
+    failed = failed || !ok;
+
+    return ok;
+  }
+
+#ifdef _WIN32
+  bool open_file(){
+    file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                       NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    return file != INVALID_HANDLE_VALUE;
+  }
+
+  bool is_open() const {return file != INVALID_HANDLE_VALUE;}
+
+  void close_file(){
+    if(file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+  }
+
+  void lock(){
+    OVERLAPPED ov = {0};
+    LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &ov);
+  }
+
+  void unlock(){
+    OVERLAPPED ov = {0};
+    UnlockFileEx(file, 0, MAXDWORD, MAXDWORD, &ov);
+  }
+
+  bool file_size(uint64_t &res){
+    LARGE_INTEGER len;
+    if(!GetFileSizeEx(file, &len))
+      return false;
+    res = len.QuadPart;
+    return true;
+  }
+
+  bool append(const char *buf, size_t len){
+    LARGE_INTEGER zero = {0};
+    DWORD written;
+
+    if(!SetFilePointerEx(file, zero, NULL, FILE_END))
+      return false;
+    for(; len > 0; buf += written, len -= written)
+      if(!WriteFile(file, buf, (DWORD)std::min<size_t>(len, 1 << 30), &written, NULL))
+        return false;
+    return true;
+  }
+
+  bool read_header(char *buf){
+    LARGE_INTEGER zero = {0};
+    DWORD read;
+    return SetFilePointerEx(file, zero, NULL, FILE_BEGIN) &&
+      ReadFile(file, buf, NAT_FSC_HEADER, &read, NULL) && read == NAT_FSC_HEADER;
+  }
+
+  bool map(size_t len){
+    size = len;
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL)
+      return false;
+    data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, len));
+    return data != nullptr;
+  }
+
+  void unmap(){
+    if(data)
+      UnmapViewOfFile(data);
+    if(mapping != NULL)
+      CloseHandle(mapping);
+    data = nullptr;
+    mapping = NULL;
+  }
+#else
+  bool open_file(){
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0666);
+    return fd >= 0;
+  }
+
+  bool is_open() const {return fd >= 0;}
+
+  void close_file(){
+    if(fd >= 0)
+      ::close(fd);
+    fd = -1;
+  }
+
+  void lock(){
+    while(flock(fd, LOCK_EX) != 0 && errno == EINTR);
+  }
+
+  void unlock(){flock(fd, LOCK_UN);}
+
+  bool file_size(uint64_t &res){
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+      return false;
+    res = st.st_size;
+    return true;
+  }
+
+  // The file is opened in append mode, so every write goes to its end
+  bool append(const char *buf, size_t len){
+    while(len > 0){
+      ssize_t written = ::write(fd, buf, len);
+      if(written < 0 && errno == EINTR)
+        continue;
+      if(written <= 0)
+        return false;
+      buf += written;
+      len -= written;
+    }
+    return true;
+  }
+
+  bool read_header(char *buf){
+    return pread(fd, buf, NAT_FSC_HEADER, 0) == (ssize_t)NAT_FSC_HEADER;
+  }
+
+  bool map(size_t len){
+    void *res = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+    if(res == MAP_FAILED)
+      return false;
+    data = static_cast<const char *>(res);
+    size = len;
+    return true;
+  }
+
+  void unmap(){
+    if(data)
+      munmap(const_cast<char *>(data), size);
+    data = nullptr;
+  }
+#endif
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef nat_suff_stats_op
+#define nat_suff_stats_op
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+// Sufficient statistics of a Gaussian dataset
+//
+// Keeps the number of rows, the mean vector and the scatter matrix, i.e., the
+// sum of the cross products of the centered rows, of a set of columns. Any
+// Gaussian family score can be computed from submatrices of these, so the
+// dataset only has to be read once. Only the lower triangle of the scatter
+// matrix is stored. Partial statistics of disjoint sets of rows can be merged
+// with the pairwise formula of Chan, Golub and LeVeque.
+class natSuffStats {
+public:
+  natSuffStats(int n_cols) : n_cols(n_cols), n(0), mean(n_cols, 0), scatter((size_t)n_cols * n_cols, 0){}
+
+  // Add a single row with Welford's online update
+  //
+  // @param x pointer to the n_cols values of the row
+  void add_row(const double *x){
+    n++;
+    delta_buf_check();
+    for(int i = 0; i < n_cols; i++){
+      delta[i] = x[i] - mean[i];
+      mean[i] += delta[i] / n;
+    }
+    for(int i = 0; i < n_cols; i++){
+      double d = x[i] - mean[i];
+      for(int j = 0; j <= i; j++)
+        scatter[(size_t)i * n_cols + j] += d * delta[j];
+    }
+  }
+
+  // Add a block of rows stored by columns. The block is summarized with the
+  // two-pass formula, which is both faster and more stable than adding the
+  // rows one by one, and then merged.
+  //
+  // @param cols pointers to the first row of the block in each column
+  // @param n_rows number of rows in the block
+  void add_columns(const std::vector<const double *> &cols, size_t n_rows){
+    const size_t block = 256;
+    natSuffStats part(n_cols);
+    std::vector<double> buf(block * n_cols);
+
+    if(n_rows == 0)
+      return;
+
+    part.n = n_rows;
+    for(int i = 0; i < n_cols; i++){
+      double acc = 0;
+      for(size_t r = 0; r < n_rows; r++)
+        acc += cols[i][r];
+      part.mean[i] = acc / n_rows;
+    }
+
+    // Cross products of the centered rows, a cache-sized block at a time
+    for(size_t r0 = 0; r0 < n_rows; r0 += block){
+      size_t b = std::min(block, n_rows - r0);
+      for(int i = 0; i < n_cols; i++)
+        for(size_t r = 0; r < b; r++)
+          buf[(size_t)i * block + r] = cols[i][r0 + r] - part.mean[i];
+      for(int i = 0; i < n_cols; i++){
+        const double *x = &buf[(size_t)i * block];
+        for(int j = 0; j <= i; j++){
+          const double *y = &buf[(size_t)j * block];
+          double acc = 0;
+          for(size_t r = 0; r < b; r++)
+            acc += x[r] * y[r];
+          part.scatter[(size_t)i * n_cols + j] += acc;
+        }
+      }
+    }
+
+    merge(part);
+  }
+
+  // Add the rows of a multivariate time series folded into max_size time
+  // slices, without building the folded dataset. As in dbnR::fold_dt, the row
+  // r of the folded column of the variable j in the time slice k is the
+  // instant r + k of the series j, so every folded column is just the series
+  // itself starting k instants later.
+  //
+  // @param series pointers to the first instant of each variable. Their
+  // number times max_size has to be n_cols.
+  // @param n_rows number of instants in the series
+  // @param max_size number of time slices
+  void add_series(const std::vector<const double *> &series, size_t n_rows, int max_size){
+    int n_series = series.size();
+    std::vector<const double *> cols(n_cols);
+
+    // Too short to fill a single folded row
+    if(n_rows < (size_t)max_size)
+      return;
+
+    for(int k = 0; k < max_size; k++)
+      for(int j = 0; j < n_series; j++)
+        cols[k * n_series + j] = series[j] + k;
+    add_columns(cols, n_rows - max_size + 1);
+  }
+
+  // Merge the statistics of another disjoint set of rows
+  //
+  // @param other the statistics to merge into this ones
+  void merge(const natSuffStats &other){
+    if(other.n == 0)
+      return;
+    if(n == 0){
+      n = other.n;
+      mean = other.mean;
+      scatter = other.scatter;
+      return;
+    }
+
+    double n_a = n, n_b = other.n, n_ab = n_a + n_b;
+    delta_buf_check();
+    for(int i = 0; i < n_cols; i++)
+      delta[i] = other.mean[i] - mean[i];
+    for(int i = 0; i < n_cols; i++)
+      for(int j = 0; j <= i; j++)
+        scatter[(size_t)i * n_cols + j] += other.scatter[(size_t)i * n_cols + j] + delta[i] * delta[j] * n_a * n_b / n_ab;
+    for(int i = 0; i < n_cols; i++)
+      mean[i] += delta[i] * n_b / n_ab;
+    n += other.n;
+  }
+
+  // Element (i, j) of the scatter matrix
+  double get_scatter(int i, int j) const {
+    if(j > i)
+      std::swap(i, j);
+    return scatter[(size_t)i * n_cols + j];
+  }
+
+  double get_mean(int i) const {return mean[i];}
+
+  size_t get_n() const {return n;}
+
+  int get_n_cols() const {return n_cols;}
+
+private:
+  int n_cols;
+  size_t n;
+  std::vector<double> mean, scatter, delta;
+
+  void delta_buf_check(){
+    if(delta.size() != (size_t)n_cols)
+      delta.resize(n_cols);
+  }
+};
+
+#endif
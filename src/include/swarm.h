@@ -0,0 +1,639 @@
+#ifndef nat_swarm_op
+#define nat_swarm_op
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <chrono>
+#include "kernels.h"
+#include "batch_kernels.h"
+#include "rng.h"
+#include "score.h"
+#include "thread_pool.h"
+#include "checkpoint.h"
+
+// How the parents over the limit of a node are removed
+enum natPrune {NAT_PRUNE_SCORE, NAT_PRUNE_RANDOM};
+
+// Parameters of the PSO that drive the movement of the particles
+struct natPsoParams {
+  double in_cte, gb_cte, lb_cte;
+  double r_min, r_max; // Range of the random variation of gb_cte and lb_cte
+  bool cte; // Whether the constants stay fixed or vary each iteration
+  double in_var, gb_var, lb_var;
+  int max_parents; // Maximum number of parents of each node. 0 means no limit
+  natPrune prune;
+};
+
+// Record of one iteration of the swarm
+struct natIterStats {
+  int iteration;
+  double move_time, score_time; // In seconds
+  size_t n_rescored; // Families scored again after the move
+  size_t cache_hits; // Of the rescored families, the ones found in the cache
+  double gb_scr;
+  double mean_abs_op; // Mean number of operations of the velocities
+  double diversity; // Mean Hamming distance between the positions of two particles
+};
+
+// Interface of the native swarms of every word type. The virtual calls are
+// made once per iteration, never inside the loops over the particles.
+class natSwarmBase {
+public:
+  virtual ~natSwarmBase(){}
+
+  // Set the initial state of a particle from the causal lists of R
+  //
+  // @param i index of the particle
+  // @param cl the position's causal list
+  // @param v the velocity's positive causal list
+  // @param v_neg the velocity's negative causal list
+  // @param n_op the number of operations of the velocity
+  virtual void set_particle(int i, const double *cl, const double *v, const double *v_neg, int n_op) = 0;
+  virtual void seed(uint64_t seed) = 0;
+  // Draw the initial positions and velocities of all particles from their own
+  // streams, so it has to be called after seed. See nat_random_position and
+  // nat_random_velocity.
+  //
+  // @param probs the weights of the operations {-1, 0, 1} of the velocities
+  // @param p the parameter of the truncated geometric sampler
+  virtual void randomize(const double *probs, double p) = 0;
+  // Move the first particles to known positions, such as the ones of networks
+  // learned before. The particle i < n_warm starts at the prior i % n_priors:
+  // the first copy of each prior exactly at it and the rest near it, with each
+  // causal unit toggled with a random unit with probability 'noise'. Their
+  // velocities are kept. It has to be called before the first evaluation.
+  //
+  // @param cls the causal lists of the priors, one after the other
+  // @param n_priors number of priors
+  // @param n_warm number of particles that start at or near a prior
+  // @param noise probability of perturbing each causal unit of the copies
+  // @param p the parameter of the truncated geometric sampler of the perturbations
+  virtual void warm_start(const double *cls, int n_priors, int n_warm, double noise, double p) = 0;
+  virtual void evaluate() = 0;
+  virtual void step() = 0;
+  virtual double get_gb_scr() const = 0;
+  virtual int get_gb_n_arcs() const = 0;
+  // The causal lists as doubles, as R stores them
+  virtual std::vector<double> get_gb_ps() const = 0;
+  // Arcs of the global best as triples of indexes, see nat_cl_to_arcs
+  virtual std::vector<int> get_gb_arcs() const = 0;
+  virtual std::vector<double> get_positions() const = 0;
+  virtual const std::vector<double>& get_lb_scr() const = 0;
+  virtual int get_n_inds() const = 0;
+  virtual size_t get_len() const = 0;
+  virtual int get_iteration() const = 0;
+  virtual int get_n_threads() const = 0;
+  // Number of bits of the words that store the causal units
+  virtual int get_word_bits() const = 0;
+  // Instruction set of the batch kernels. Asking for one that the machine
+  // does not support selects the best one available.
+  virtual void set_isa(natIsa isa) = 0;
+  virtual natIsa get_isa() const = 0;
+  // Records of all the iterations performed
+  virtual const std::vector<natIterStats>& get_history() const = 0;
+  // Usage statistics of the caches of all the scorers of the swarm
+  virtual natCacheStats get_cache_stats() const = 0;
+  // Write the whole state of the swarm into a checkpoint, and read it back
+  // into a swarm created with the same sizes. A swarm loaded from a
+  // checkpoint continues exactly as the one that wrote it.
+  virtual void save(natCheckpointOut &out) const = 0;
+  // @return whether the checkpoint matched the swarm. If not, the state of
+  // the swarm is undefined.
+  virtual bool load(natCheckpointIn &in) = 0;
+};
+
+// Native swarm of particles
+//
+// Holds the state of every particle of the PSO in structure-of-arrays form:
+// each kind of causal list of all particles lives in a single contiguous
+// arena, where the particle i owns the range [i * len, (i + 1) * len). A whole
+// iteration of the algorithm is performed with a single call to 'step'.
+//
+// Unlike the R6 natParticle, the local and global bests are stored as copies
+// of the positions, not as references to positions that keep moving.
+//
+// The particles are moved and scored in parallel by a pool of threads. Each
+// particle draws from its own counter-based random stream and the family
+// scores are reduced in a fixed order, so the results do not depend on the
+// number of threads.
+//
+// The deterministic parts of the movement, the differences to the bests and
+// the sums of velocities and positions, are done with the batch kernels over
+// blocks of contiguous particles. Only the random scaling of the velocities is
+// done particle by particle.
+//
+// Moving a particle marks the nodes whose parents changed as dirty. Only the
+// families of those nodes are scored again, and only the particles with some
+// dirty family are compared with the bests. As the swarm converges the
+// velocities shrink and most families stay clean.
+//
+// The causal units are stored in words of type W, which has to hold at least
+// max_size - 1 bits. Use nat_create_swarm to pick the smallest one. S is the
+// type of the scorer, a natScore of some score policy, so the families are
+// scored without virtual calls.
+template <typename W, class S = natBgeScore>
+class natSwarm : public natSwarmBase {
+public:
+  // @param scorer the scorer used to evaluate the positions. It is not owned by the swarm
+  // @param n_inds number of particles in the swarm
+  // @param max_size maximum number of timeslices of the DBN
+  // @param params the parameters of the PSO
+  // @param n_threads number of threads used to move and score the particles
+  natSwarm(S *scorer, int n_inds, int max_size, const natPsoParams &params, int n_threads = 1) :
+    scorer(scorer), n_inds(n_inds), max_size(max_size), params(params), it(0), pool(n_threads){
+    n_vars = scorer->get_n_vars();
+    len = (size_t)n_vars * n_vars;
+    ps.assign(n_inds * len, W());
+    lb_ps.assign(n_inds * len, W());
+    vl.assign(n_inds * len, W());
+    vl_neg.assign(n_inds * len, W());
+    vl_gb.assign(n_inds * len, W());
+    vl_gb_neg.assign(n_inds * len, W());
+    vl_lb.assign(n_inds * len, W());
+    vl_lb_neg.assign(n_inds * len, W());
+    gb_ps.assign(len, W());
+    n_arcs.assign(n_inds, 0);
+    abs_op.assign(n_inds, 0);
+    op_gb.assign(n_inds, 0);
+    op_lb.assign(n_inds, 0);
+    lb_scr.assign(n_inds, -INFINITY);
+    fam_scr.assign((size_t)n_inds * n_vars, 0);
+    factors.resize((size_t)n_inds * n_vars);
+    scr.assign(n_inds, -INFINITY);
+    dirty.assign(n_inds * nat_dirty_words(n_vars), 0);
+    rngs.resize(n_inds);
+    bufs.resize(pool.get_n_threads());
+    op_pools.resize(pool.get_n_threads());
+    diffs.assign(pool.get_n_threads(), std::vector<uint8_t>(len * sizeof(W)));
+    gb_scr = -INFINITY;
+    gb_idx = -1;
+    kernels = nat_batch_kernels_for(NAT_ISA_AVX512);
+    // Around four blocks of particles per thread for the batch kernels
+    block = std::max(1, n_inds / (4 * pool.get_n_threads()));
+  }
+
+  void set_particle(int i, const double *cl, const double *v, const double *v_neg, int n_op){
+    n_arcs[i] = 0;
+    for(size_t j = 0; j < len; j++){
+      ps[i * len + j] = nat_to_word<W>(cl[j]);
+      vl[i * len + j] = nat_to_word<W>(v[j]);
+      vl_neg[i * len + j] = nat_to_word<W>(v_neg[j]);
+      n_arcs[i] += nat_bitcount(ps[i * len + j]);
+    }
+    abs_op[i] = n_op;
+    mark_dirty(i);
+  }
+
+  // Seed the random streams of the particles. The particle i draws from the
+  // stream first_stream + i of the seed.
+  void seed(uint64_t seed, uint64_t first_stream){
+    for(int i = 0; i < n_inds; i++)
+      rngs[i] = natCounterRng(seed, first_stream + i);
+  }
+
+  void seed(uint64_t seed){this->seed(seed, 0);}
+
+  void randomize(const double *probs, double p){
+    pool.parallel_for(n_inds, [&](size_t i, int){
+      n_arcs[i] = nat_random_position(&ps[i * len], len, max_size, p, rngs[i]);
+      abs_op[i] = nat_random_velocity(&vl[i * len], &vl_neg[i * len], len, max_size, probs, p, rngs[i]);
+      mark_dirty(i);
+    });
+  }
+
+  void warm_start(const double *cls, int n_priors, int n_warm, double noise, double p){
+    natUnitSampler<W> sampler(p, max_size - 1);
+
+    pool.parallel_for(std::min(n_warm, n_inds), [&](size_t i, int){
+      const double *cl = &cls[(i % n_priors) * len];
+      bool copy = (int)i >= n_priors;
+      W unit;
+
+      n_arcs[i] = 0;
+      for(size_t j = 0; j < len; j++){
+        unit = nat_to_word<W>(cl[j]);
+        if(copy && rngs[i].unif01() < noise)
+          unit ^= sampler(rngs[i]);
+        ps[i * len + j] = unit;
+        n_arcs[i] += nat_bitcount(unit);
+      }
+      mark_dirty(i);
+    });
+  }
+
+  // Replace the particle with the worst current score by a position that comes
+  // from another swarm, if the position is better. The velocity of the
+  // particle is kept and its families are scored again in the next evaluation.
+  //
+  // @param cl the causal list of the position
+  // @param cl_scr the score of the position
+  void immigrate(const W *cl, double cl_scr){
+    int worst = std::min_element(scr.begin(), scr.end()) - scr.begin();
+
+    if(!(cl_scr > scr[worst]))
+      return;
+
+    std::copy(cl, cl + len, ps.begin() + worst * len);
+    n_arcs[worst] = 0;
+    for(size_t j = 0; j < len; j++)
+      n_arcs[worst] += nat_bitcount(cl[j]);
+    scr[worst] = cl_scr;
+    if(cl_scr > lb_scr[worst]){
+      lb_scr[worst] = cl_scr;
+      std::copy(cl, cl + len, lb_ps.begin() + worst * len);
+    }
+    if(cl_scr > gb_scr){
+      gb_scr = cl_scr;
+      gb_idx = worst;
+      std::copy(cl, cl + len, gb_ps.begin());
+    }
+    mark_dirty(worst);
+  }
+
+  // Evaluate the particles, updating their local bests and the global best.
+  // Each dirty family of each particle is a separate task, and the scores are
+  // then added and compared serially in the order of the particles. If there
+  // is a maximum number of parents, the dirty families over it are pruned
+  // first, so no family larger than the limit is ever scored.
+  void evaluate(){
+    size_t words = nat_dirty_words(n_vars);
+    bool moved;
+
+    if(params.max_parents > 0)
+      pool.parallel_for(n_inds, [this](size_t i, int worker){
+        cap_parents(i, worker);
+      });
+
+    tasks.clear();
+    for(int i = 0; i < n_inds; i++){
+      for(size_t w = 0; w < words; w++){
+        uint64_t bits = dirty[i * words + w];
+        while(bits){
+          int node = w * 64 + nat_lowest_bit(bits);
+          tasks.push_back((size_t)i * n_vars + node);
+          nat_clear_bit(bits, node % 64);
+        }
+      }
+    }
+
+    // The hits of the pruning above are not counted
+    size_t hits = buffer_hits();
+    pool.parallel_for(tasks.size(), [this](size_t t, int worker){
+      size_t task = tasks[t];
+      int node = task % n_vars;
+      fam_scr[task] = scorer->family_score(node, &ps[(task / n_vars) * len + node * n_vars], bufs[worker], &factors[task]);
+    });
+    eval_hits = buffer_hits() - hits;
+
+    for(int i = 0; i < n_inds; i++){
+      moved = false;
+      for(size_t w = 0; w < words; w++){
+        moved = moved || dirty[i * words + w];
+        dirty[i * words + w] = 0;
+      }
+      // The score of a particle that did not move cannot improve its bests
+      if(!moved)
+        continue;
+
+      scr[i] = 0;
+      for(int j = 0; j < n_vars; j++)
+        scr[i] += fam_scr[(size_t)i * n_vars + j];
+      if(scr[i] > lb_scr[i]){
+        lb_scr[i] = scr[i];
+        std::copy(ps.begin() + i * len, ps.begin() + (i + 1) * len, lb_ps.begin() + i * len);
+      }
+      if(scr[i] > gb_scr){
+        gb_scr = scr[i];
+        gb_idx = i;
+        std::copy(ps.begin() + i * len, ps.begin() + (i + 1) * len, gb_ps.begin());
+      }
+    }
+  }
+
+  // Perform one iteration of the algorithm: move all the particles, adjust the
+  // parameters if they are not constant and evaluate the new positions.
+  void step(){
+    size_t n_blocks = (n_inds + block - 1) / block;
+    natIterStats stats;
+    auto start = std::chrono::steady_clock::now();
+
+    // 1.- Differences to the global and local bests
+    pool.parallel_for(n_blocks, [this](size_t b, int){
+      int first = b * block, last = std::min(n_inds, first + block);
+      nat_batch_pos_minus_pos(kernels, ps.data(), gb_ps.data(), 0, vl_gb.data(), vl_gb_neg.data(),
+                              len, first, last, op_gb.data());
+      nat_batch_pos_minus_pos(kernels, ps.data(), lb_ps.data(), len, vl_lb.data(), vl_lb_neg.data(),
+                              len, first, last, op_lb.data());
+    });
+
+    // 2.- Random scaling of the velocities
+    pool.parallel_for(n_inds, [this](size_t i, int worker){
+      scale_velocities(i, rngs[i], op_pools[worker]);
+    });
+
+    // 3.- New velocities and positions
+    pool.parallel_for(n_blocks, [this](size_t b, int worker){
+      int first = b * block, last = std::min(n_inds, first + block);
+      nat_batch_vel_plus_vel(kernels, vl.data(), vl_neg.data(), vl_gb.data(), vl_gb_neg.data(),
+                             len, first, last, abs_op.data(), op_gb.data());
+      nat_batch_vel_plus_vel(kernels, vl.data(), vl_neg.data(), vl_lb.data(), vl_lb_neg.data(),
+                             len, first, last, abs_op.data(), op_lb.data());
+      nat_batch_pos_plus_vel(kernels, ps.data(), vl.data(), vl_neg.data(), len, n_vars, first, last,
+                             n_arcs.data(), dirty.data(), diffs[worker].data());
+    });
+
+    if(!params.cte){
+      params.in_cte -= params.in_var;
+      params.gb_cte += params.gb_var;
+      params.lb_cte -= params.lb_var;
+    }
+
+    auto moved = std::chrono::steady_clock::now();
+    evaluate();
+    it++;
+
+    stats.iteration = it;
+    stats.move_time = std::chrono::duration<double>(moved - start).count();
+    stats.score_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - moved).count();
+    stats.n_rescored = tasks.size();
+    stats.cache_hits = eval_hits;
+    stats.gb_scr = gb_scr;
+    stats.mean_abs_op = 0;
+    for(int i = 0; i < n_inds; i++)
+      stats.mean_abs_op += abs_op[i];
+    stats.mean_abs_op /= n_inds;
+    stats.diversity = diversity();
+    history.push_back(stats);
+  }
+
+  std::vector<double> get_gb_ps() const {
+    std::vector<double> res(len);
+    for(size_t j = 0; j < len; j++)
+      res[j] = nat_word_to_double(gb_ps[j]);
+    return res;
+  }
+
+  std::vector<int> get_gb_arcs() const {
+    std::vector<int> res;
+    nat_cl_to_arcs(gb_ps.data(), n_vars, res);
+    return res;
+  }
+
+  std::vector<double> get_positions() const {
+    std::vector<double> res(ps.size());
+    for(size_t j = 0; j < ps.size(); j++)
+      res[j] = nat_word_to_double(ps[j]);
+    return res;
+  }
+
+  double get_gb_scr() const {return gb_scr;}
+
+  int get_gb_n_arcs() const {
+    int res = 0;
+    for(size_t j = 0; j < len; j++)
+      res += nat_bitcount(gb_ps[j]);
+    return res;
+  }
+
+  const std::vector<W>& get_ps() const {return ps;}
+
+  const std::vector<W>& get_gb_words() const {return gb_ps;}
+
+  const std::vector<double>& get_lb_scr() const {return lb_scr;}
+
+  const std::vector<int>& get_abs_op() const {return abs_op;}
+
+  int get_n_inds() const {return n_inds;}
+
+  size_t get_len() const {return len;}
+
+  int get_iteration() const {return it;}
+
+  int get_n_threads() const {return pool.get_n_threads();}
+
+  int get_word_bits() const {return natWordBits<W>::value;}
+
+  void set_isa(natIsa isa){kernels = nat_batch_kernels_for(isa);}
+
+  natIsa get_isa() const {return kernels.isa;}
+
+  const std::vector<natIterStats>& get_history() const {return history;}
+
+  natCacheStats get_cache_stats() const {
+    natCacheStats res;
+    res.add(scorer->get_cache());
+    return res;
+  }
+
+  // The velocities towards the bests are not saved, as each iteration
+  // computes them again from the positions
+  void save(natCheckpointOut &out) const {
+    std::vector<uint64_t> rng_state(2 * n_inds);
+
+    for(int i = 0; i < n_inds; i++){
+      rng_state[2 * i] = rngs[i].get_key();
+      rng_state[2 * i + 1] = rngs[i].get_counter();
+    }
+    out.put(get_word_bits());
+    out.put(n_inds);
+    out.put(max_size);
+    out.put((uint64_t)len);
+    out.put(params);
+    out.put(it);
+    out.put(gb_idx);
+    out.put(gb_scr);
+    out.put(ps);
+    out.put(lb_ps);
+    out.put(gb_ps);
+    out.put(vl);
+    out.put(vl_neg);
+    out.put(n_arcs);
+    out.put(abs_op);
+    out.put(lb_scr);
+    out.put(fam_scr);
+    out.put(scr);
+    out.put(dirty);
+    out.put(rng_state);
+    out.put(history);
+  }
+
+  bool load(natCheckpointIn &in){
+    int bits = 0, inds = 0, size = 0;
+    uint64_t l = 0;
+    std::vector<uint64_t> rng_state;
+
+    in.get(bits);
+    in.get(inds);
+    in.get(size);
+    in.get(l);
+    if(!in.good() || bits != get_word_bits() || inds != n_inds || size != max_size || l != len){
+      in.fail();
+      return false;
+    }
+    in.get(params);
+    in.get(it);
+    in.get(gb_idx);
+    in.get(gb_scr);
+    in.get(ps, ps.size());
+    in.get(lb_ps, lb_ps.size());
+    in.get(gb_ps, gb_ps.size());
+    in.get(vl, vl.size());
+    in.get(vl_neg, vl_neg.size());
+    in.get(n_arcs, n_arcs.size());
+    in.get(abs_op, abs_op.size());
+    in.get(lb_scr, lb_scr.size());
+    in.get(fam_scr, fam_scr.size());
+    in.get(scr, scr.size());
+    in.get(dirty, dirty.size());
+    in.get(rng_state, 2 * n_inds);
+    in.get(history);
+    if(!in.good())
+      return false;
+    for(int i = 0; i < n_inds; i++){
+      rngs[i].set_key(rng_state[2 * i]);
+      rngs[i].set_counter(rng_state[2 * i + 1]);
+    }
+
+    return true;
+  }
+
+  // Mean Hamming distance between the positions of every pair of particles.
+  // An arc present in c of the n particles differs in c * (n - c) pairs, so
+  // only the arcs of each position have to be counted.
+  double diversity(){
+    int bits = max_size - 1;
+    double res = 0;
+
+    if(n_inds < 2)
+      return 0;
+
+    bit_counts.assign(bits, 0);
+    for(size_t j = 0; j < len; j++){
+      std::fill(bit_counts.begin(), bit_counts.end(), 0);
+      for(int i = 0; i < n_inds; i++){
+        W unit = ps[i * len + j];
+        while(!nat_is_zero(unit)){
+          int k = nat_lowest_bit(unit);
+          bit_counts[k]++;
+          nat_clear_bit(unit, k);
+        }
+      }
+      for(int k = 0; k < bits; k++)
+        res += (double)bit_counts[k] * (n_inds - bit_counts[k]);
+    }
+
+    return res / ((double)n_inds * (n_inds - 1) / 2);
+  }
+
+private:
+  S *scorer;
+  int n_inds, max_size, n_vars;
+  size_t len;
+  natPsoParams params;
+  int it, gb_idx;
+  double gb_scr;
+  std::vector<W> ps, lb_ps, gb_ps;
+  std::vector<W> vl, vl_neg, vl_gb, vl_gb_neg, vl_lb, vl_lb_neg;
+  std::vector<int> n_arcs, abs_op, op_gb, op_lb;
+  std::vector<double> lb_scr, fam_scr, scr; // fam_scr holds the score of each family of each particle
+  std::vector<uint64_t> dirty; // Bitmap of the families of each particle that have to be scored again
+  std::vector<size_t> tasks; // Families scored in each evaluation
+  size_t eval_hits = 0; // Of the tasks of the last evaluation, the ones found in the cache
+  std::vector<natIterStats> history;
+  std::vector<int> bit_counts;
+  std::vector<natCounterRng> rngs; // One per particle
+  natThreadPool pool;
+  std::vector<natScoreBuffers> bufs; // One per thread
+  // Factor of the last family scored of each node of each particle. Between
+  // iterations a family usually changes in a few parents, so the rows of the
+  // factor before the first change can be kept.
+  std::vector<natCholFactor> factors;
+  std::vector<natOpPool> op_pools; // One per thread
+  std::vector<std::vector<uint8_t>> diffs; // One per thread, the bits flipped by each move
+  natBatchKernels kernels;
+  int block; // Number of particles processed by each task of the batch kernels
+
+  void mark_dirty(int i){
+    size_t words = nat_dirty_words(n_vars);
+
+    for(int j = 0; j < n_vars; j++)
+      dirty[i * words + j / 64] |= 1ULL << (j % 64);
+  }
+
+  // Cache hits of the lookups of this swarm. The cache may be shared with
+  // other swarms, so its own counter is not used.
+  size_t buffer_hits() const {
+    size_t res = 0;
+    for(const natScoreBuffers &b : bufs)
+      res += b.hits;
+    return res;
+  }
+
+  // Limit the number of parents of the dirty families of a particle. Random
+  // pruning draws from the stream of the particle, so it does not depend on
+  // the number of threads either.
+  void cap_parents(int i, int worker){
+    size_t words = nat_dirty_words(n_vars);
+
+    for(size_t w = 0; w < words; w++){
+      uint64_t bits = dirty[i * words + w];
+      while(bits){
+        int node = w * 64 + nat_lowest_bit(bits);
+        W *row = &ps[i * len + node * n_vars];
+        nat_clear_bit(bits, node % 64);
+        if(params.prune == NAT_PRUNE_RANDOM)
+          n_arcs[i] -= nat_cap_parents(row, n_vars, params.max_parents, rngs[i]);
+        else
+          n_arcs[i] -= nat_prune_parents(row, n_vars, params.max_parents, [&](const W *r){
+            return scorer->family_score(node, r, bufs[worker], &factors[(size_t)i * n_vars + node]);
+          });
+      }
+    }
+  }
+
+  // Scale the inertia of a particle and its velocities towards the bests, the
+  // same as natParticle$update_state does. The random numbers are drawn in the
+  // same order as in the R6 particle.
+  template <class Rng>
+  void scale_velocities(int i, Rng &rng, natOpPool &op_pool){
+    double k;
+
+    abs_op[i] = nat_scale_vel(params.in_cte, &vl[i * len], &vl_neg[i * len], len, abs_op[i], max_size, rng, op_pool);
+    k = params.gb_cte * rng.unif(params.r_min, params.r_max);
+    op_gb[i] = nat_scale_vel(k, &vl_gb[i * len], &vl_gb_neg[i * len], len, op_gb[i], max_size, rng, op_pool);
+    k = params.lb_cte * rng.unif(params.r_min, params.r_max);
+    op_lb[i] = nat_scale_vel(k, &vl_lb[i * len], &vl_lb_neg[i * len], len, op_lb[i], max_size, rng, op_pool);
+  }
+};
+
+// Maximum number of time slices supported by the native swarm
+const int NAT_MAX_SLICES = 257;
+
+// Create a native swarm that stores the causal units in the smallest word
+// that holds max_size - 1 bits
+//
+// @return the new swarm, or nullptr if max_size is greater than NAT_MAX_SLICES
+template <class S>
+natSwarmBase* nat_create_swarm(S *scorer, int n_inds, int max_size,
+                                      const natPsoParams &params, int n_threads){
+  int bits = max_size - 1;
+
+  if(bits <= 8)
+    return new natSwarm<uint8_t, S>(scorer, n_inds, max_size, params, n_threads);
+  if(bits <= 16)
+    return new natSwarm<uint16_t, S>(scorer, n_inds, max_size, params, n_threads);
+  if(bits <= 32)
+    return new natSwarm<uint32_t, S>(scorer, n_inds, max_size, params, n_threads);
+  if(bits <= 64)
+    return new natSwarm<uint64_t, S>(scorer, n_inds, max_size, params, n_threads);
+  if(bits <= 128)
+    return new natSwarm<natBitset<2>, S>(scorer, n_inds, max_size, params, n_threads);
+  if(bits <= 256)
+    return new natSwarm<natBitset<4>, S>(scorer, n_inds, max_size, params, n_threads);
+
+  return nullptr;
+}
+
+#endif
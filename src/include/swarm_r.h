@@ -0,0 +1,48 @@
+#ifndef Rcpp_head
+#define Rcpp_head
+#include <Rcpp.h>
+using namespace Rcpp;
+#endif
+
+#include "utils.h"
+#include "score_r.h"
+#include "swarm.h"
+#include "islands.h"
+
+#ifndef nat_swarm_r_op
+#define nat_swarm_r_op
+
+// Wrapper of the native swarm exposed to R as the 'natSwarmCpp' class in the
+// 'nat_swarm_module' module. The swarm can also be an island model of several
+// swarms. It keeps a reference to the R external pointer of
+// the scorer so that it is not garbage collected while the swarm lives.
+class natSwarmCpp {
+public:
+  natSwarmCpp(SEXP scorer, const Rcpp::NumericMatrix &ps, const Rcpp::NumericMatrix &vl,
+              const Rcpp::NumericMatrix &vl_neg, const Rcpp::NumericVector &abs_op, const Rcpp::List &params);
+  natSwarmCpp(SEXP scorer, int n_inds, const Rcpp::List &params);
+  void step();
+  void evaluate();
+  double get_gb_scr();
+  Rcpp::NumericVector get_gb_ps();
+  Rcpp::IntegerMatrix get_gb_arcs();
+  int get_gb_n_arcs();
+  Rcpp::NumericMatrix get_positions();
+  Rcpp::NumericVector get_lb_scr();
+  int get_iteration();
+  int get_word_bits();
+  std::string get_isa();
+  Rcpp::DataFrame get_history(int from);
+  Rcpp::List get_cache_stats();
+  void save_checkpoint(std::string file);
+  void load_checkpoint(std::string file);
+  void warm_start(const Rcpp::NumericMatrix &priors, int n_warm, double noise, double p);
+
+private:
+  Rcpp::RObject scorer_ref;
+  std::unique_ptr<natSwarmBase> swarm;
+
+  void create(SEXP scorer, int n_inds, const Rcpp::List &params);
+};
+
+#endif
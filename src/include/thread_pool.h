@@ -0,0 +1,160 @@
+#ifndef nat_thread_pool_op
+#define nat_thread_pool_op
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <cstddef>
+
+// Pool of worker threads with work stealing
+//
+// A parallel_for splits its tasks into one contiguous range per worker. Each
+// worker takes tasks from the front of its own range and, once it is empty,
+// steals the back half of the range of another worker, so uneven tasks stay
+// balanced without a shared queue. The calling thread acts as the worker 0,
+// so a pool of 1 thread runs everything serially without spawning threads.
+//
+// The tasks must not call the R API nor throw exceptions.
+class natThreadPool {
+public:
+  // @param n_threads total number of threads, the calling one included
+  natThreadPool(int n_threads) : n_threads(n_threads < 1 ? 1 : n_threads), generation(0),
+    pending(0), stop(false){
+    for(int i = 0; i < this->n_threads; i++)
+      ranges.push_back(std::unique_ptr<natTaskRange>(new natTaskRange()));
+    for(int i = 1; i < this->n_threads; i++)
+      workers.push_back(std::thread(&natThreadPool::worker_loop, this, i));
+  }
+
+  ~natThreadPool(){
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stop = true;
+    }
+    wake.notify_all();
+    for(auto &w : workers)
+      w.join();
+  }
+
+  // Run fn(task, worker) for each task in [0, n_tasks) and wait for all of them
+  //
+  // @param n_tasks number of tasks
+  // @param fn the function to run. It receives the index of the task and the
+  // index of the worker in [0, n_threads), to access per worker buffers.
+  void parallel_for(size_t n_tasks, const std::function<void(size_t, int)> &fn){
+    if(n_threads == 1 || n_tasks < 2){
+      for(size_t i = 0; i < n_tasks; i++)
+        fn(i, 0);
+      return;
+    }
+
+    for(int i = 0; i < n_threads; i++){
+      std::lock_guard<std::mutex> lock(ranges[i]->mtx);
+      ranges[i]->begin = n_tasks * i / n_threads;
+      ranges[i]->end = n_tasks * (i + 1) / n_threads;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      job = &fn;
+      pending = n_threads - 1;
+      generation++;
+    }
+    wake.notify_all();
+
+    run_tasks(0);
+
+    std::unique_lock<std::mutex> lock(mtx);
+    done.wait(lock, [this]{return pending == 0;});
+    job = nullptr;
+  }
+
+  int get_n_threads() const {return n_threads;}
+
+private:
+  struct natTaskRange {
+    natTaskRange() : begin(0), end(0){}
+    size_t begin, end;
+    std::mutex mtx;
+  };
+
+  int n_threads;
+  size_t generation;
+  int pending;
+  bool stop;
+  const std::function<void(size_t, int)> *job = nullptr;
+  std::vector<std::unique_ptr<natTaskRange>> ranges;
+  std::vector<std::thread> workers;
+  std::mutex mtx;
+  std::condition_variable wake, done;
+
+  void worker_loop(int id){
+    size_t seen = 0;
+
+    while(true){
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        wake.wait(lock, [this, seen]{return stop || generation != seen;});
+        if(stop)
+          return;
+        seen = generation;
+      }
+
+      run_tasks(id);
+
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending--;
+      }
+      done.notify_one();
+    }
+  }
+
+  // Take the next task of the worker, stealing from the others when its own
+  // range is empty
+  bool next_task(int id, size_t &task){
+    natTaskRange &own = *ranges[id];
+    {
+      std::lock_guard<std::mutex> lock(own.mtx);
+      if(own.begin < own.end){
+        task = own.begin++;
+        return true;
+      }
+    }
+
+    for(int k = 1; k < n_threads; k++){
+      natTaskRange &victim = *ranges[(id + k) % n_threads];
+      size_t begin, end;
+      {
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if(victim.begin >= victim.end)
+          continue;
+        // Steal the back half, at least one task
+        begin = victim.begin + (victim.end - victim.begin) / 2;
+        end = victim.end;
+        victim.end = begin;
+      }
+      task = begin;
+      if(begin + 1 < end){
+        std::lock_guard<std::mutex> lock(own.mtx);
+        own.begin = begin + 1;
+        own.end = end;
+      }
+      return true;
+    }
+
+    return false;
+  }
+
+  void run_tasks(int id){
+    size_t task;
+
+    while(next_task(id, task))
+      (*job)(task, id);
+  }
+};
+
+#endif
@@ -11,6 +11,7 @@ using namespace Rcpp;
 #include <random>
 #include <vector>
 #include <string>
+#include <cstdint>
 
 static const std::vector<unsigned int> MASKS = { // --ICO-Merge: delete
   0x1,
@@ -19,7 +20,7 @@ static const std::vector<unsigned int> MASKS = { // --ICO-Merge: delete
   0xFF,
   0xFFFF};
 
-int one_hot_cpp(int nat);
+double one_hot_cpp(int nat);
 int bitcount(unsigned x);
 Rcpp::StringVector find_name_and_index(std::string node);
 void include_arc(Rcpp::StringMatrix &res, const Rcpp::StringVector &ordering, int i, int j, int &k);
@@ -34,4 +35,50 @@ Rcpp::NumericVector init_cl_cpp(int n_nodes);
 Rcpp::StringVector crop_names_cpp(Rcpp::StringVector names);
 int debug_cpp(int x, bool op, bool remove, int max_int);
 
+// Random number source for the native kernels that draws from R's RNG
+// without allocating any R objects. Each draw is the same one that the
+// equivalent R call makes, so results obtained with 'set.seed' are kept:
+// 'index' samples like 'sample(seq(0, n - 1), 1)', 'unif' like 'runif(1, a, b)'
+// and 'choice' like 'rmultinom(1, 1, probs)'. The caller must hold an
+// Rcpp::RNGScope, which exported functions already do.
+struct natRRng {
+  int index(int n){
+    return static_cast<int>(R_unif_index(n));
+  }
+
+  double unif01(){
+    return R::runif(0, 1);
+  }
+
+  double unif(double a, double b){
+    return R::runif(a, b);
+  }
+
+  int choice(const double *probs, int k){
+    double total = 0;
+    std::vector<double> p(probs, probs + k);
+    std::vector<int> res(k);
+
+    for(int i = 0; i < k; i++)
+      total += p[i];
+    for(int i = 0; i < k; i++)
+      p[i] /= total;
+    R::rmultinom(1, p.data(), k, res.data());
+    for(int i = 0; i < k; i++)
+      if(res[i] == 1)
+        return i;
+
+    return k - 1;
+  }
+};
+
+// Seed for the native random streams, drawn from R's RNG so that 'set.seed'
+// also makes the native code reproducible
+inline uint64_t nat_seed_from_r(){
+  uint64_t hi = static_cast<uint64_t>(unif_rand() * 4294967296.0);
+  uint64_t lo = static_cast<uint64_t>(unif_rand() * 4294967296.0);
+
+  return (hi << 32) | lo;
+}
+
 #endif
\ No newline at end of file
@@ -6,6 +6,7 @@ using namespace Rcpp;
 
 #include "utils.h"
 #include "causality_list.h"
+#include "kernels.h"
 #include <vector>
 
 #ifndef nat_vl_op
@@ -16,6 +17,7 @@ int nat_pos_minus_pos_cpp(const Rcpp::NumericVector &ps1, const Rcpp::NumericVec
 int nat_vel_plus_vel_cpp(Rcpp::NumericVector &vl1, Rcpp::NumericVector &vl1_neg, 
                           const Rcpp::NumericVector &vl2, const Rcpp::NumericVector &vl2_neg, 
                           int abs_op1, int abs_op2);
-void add_nat_vel(int &num1, int num2, int &abs_op);
 int nat_cte_times_vel_cpp(float k, Rcpp::NumericVector &vl, Rcpp::NumericVector &vl_neg, int abs_op, int max_size);
+int nat_random_velocity_cpp(Rcpp::NumericVector &vl, Rcpp::NumericVector &vl_neg, int max_size,
+                            const Rcpp::NumericVector &probs, double p);
 #endif
\ No newline at end of file
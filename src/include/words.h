@@ -0,0 +1,283 @@
+#ifndef nat_words_op
+#define nat_words_op
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+
+// Word types of the causal units
+//
+// Each causal unit holds one bit per time slice other than t_0, so a network
+// of max_size slices needs words of max_size - 1 bits. The native code stores
+// the causal lists in the smallest unsigned integer that fits them, or in a
+// natBitset of several 64 bit words for longer horizons. Every operation on
+// the words that the kernels need is defined here for all of them, so the
+// kernels can be templated on the word type.
+
+// Fixed size bitset of N 64 bit words. Word 0 holds the lowest bits.
+template <int N>
+struct natBitset {
+  uint64_t w[N];
+
+  natBitset(){
+    for(int i = 0; i < N; i++)
+      w[i] = 0;
+  }
+
+  // Conversion from the integers stored in R, which only fill the first word
+  explicit natBitset(uint64_t x){
+    w[0] = x;
+    for(int i = 1; i < N; i++)
+      w[i] = 0;
+  }
+
+  natBitset& operator|=(const natBitset &o){for(int i = 0; i < N; i++) w[i] |= o.w[i]; return *this;}
+  natBitset& operator&=(const natBitset &o){for(int i = 0; i < N; i++) w[i] &= o.w[i]; return *this;}
+  natBitset& operator^=(const natBitset &o){for(int i = 0; i < N; i++) w[i] ^= o.w[i]; return *this;}
+  natBitset operator|(const natBitset &o) const {natBitset r(*this); return r |= o;}
+  natBitset operator&(const natBitset &o) const {natBitset r(*this); return r &= o;}
+  natBitset operator^(const natBitset &o) const {natBitset r(*this); return r ^= o;}
+
+  natBitset operator~() const {
+    natBitset r;
+    for(int i = 0; i < N; i++)
+      r.w[i] = ~w[i];
+    return r;
+  }
+
+  bool operator==(const natBitset &o) const {
+    for(int i = 0; i < N; i++)
+      if(w[i] != o.w[i])
+        return false;
+    return true;
+  }
+
+  bool operator!=(const natBitset &o) const {return !(*this == o);}
+};
+
+// Number of bits of a word type
+template <typename W>
+struct natWordBits {static const int value = sizeof(W) * 8;};
+
+template <int N>
+struct natWordBits<natBitset<N>> {static const int value = N * 64;};
+
+inline int nat_bitcount(uint64_t x){
+#if defined(__GNUC__)
+  return __builtin_popcountll(x);
+#else
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+inline int nat_bitcount(uint32_t x){
+#if defined(__GNUC__)
+  return __builtin_popcount(x);
+#else
+  return nat_bitcount((uint64_t)x);
+#endif
+}
+
+inline int nat_bitcount(uint16_t x){return nat_bitcount((uint32_t)x);}
+
+inline int nat_bitcount(uint8_t x){return nat_bitcount((uint32_t)x);}
+
+template <int N>
+inline int nat_bitcount(const natBitset<N> &x){
+  int res = 0;
+  for(int i = 0; i < N; i++)
+    res += nat_bitcount(x.w[i]);
+  return res;
+}
+
+template <typename W>
+inline bool nat_is_zero(const W &x){return x == 0;}
+
+template <int N>
+inline bool nat_is_zero(const natBitset<N> &x){
+  for(int i = 0; i < N; i++)
+    if(x.w[i])
+      return false;
+  return true;
+}
+
+// Word with the bit k (0-based) set
+template <typename W>
+inline W nat_bit(int k){return static_cast<W>(static_cast<W>(1) << k);}
+
+template <int N>
+inline natBitset<N> nat_bit_bs(int k){
+  natBitset<N> r;
+  r.w[k / 64] = 1ULL << (k % 64);
+  return r;
+}
+
+template <typename W>
+inline bool nat_test_bit(const W &x, int k){return (x >> k) & 1;}
+
+template <int N>
+inline bool nat_test_bit(const natBitset<N> &x, int k){return (x.w[k / 64] >> (k % 64)) & 1;}
+
+// Word with the n lowest bits set
+template <typename W>
+inline W nat_low_mask(int n){
+  if(n >= natWordBits<W>::value)
+    return static_cast<W>(~static_cast<W>(0));
+  return static_cast<W>((static_cast<W>(1) << n) - 1);
+}
+
+template <int N>
+inline natBitset<N> nat_low_mask_bs(int n){
+  natBitset<N> r;
+  for(int i = 0; i < N; i++){
+    if(n >= 64 * (i + 1))
+      r.w[i] = ~0ULL;
+    else if(n > 64 * i)
+      r.w[i] = (1ULL << (n - 64 * i)) - 1;
+  }
+  return r;
+}
+
+// Index (0-based) of the lowest bit set to 1. The word cannot be 0.
+template <typename W>
+inline int nat_lowest_bit(const W &x){
+#if defined(__GNUC__)
+  return __builtin_ctzll((uint64_t)x);
+#else
+  int k = 0;
+  while(!((x >> k) & 1))
+    k++;
+  return k;
+#endif
+}
+
+template <int N>
+inline int nat_lowest_bit(const natBitset<N> &x){
+  for(int i = 0; i < N; i++)
+    if(x.w[i])
+      return 64 * i + nat_lowest_bit(x.w[i]);
+  return N * 64;
+}
+
+template <typename W>
+inline void nat_clear_bit(W &x, int k){x = static_cast<W>(x & ~nat_bit<W>(k));}
+
+template <int N>
+inline void nat_clear_bit(natBitset<N> &x, int k){x.w[k / 64] &= ~(1ULL << (k % 64));}
+
+// Position of the k-th bit set to 1 in each byte, built once
+struct natSelectTable {
+  uint8_t pos[256][8];
+
+  natSelectTable(){
+    for(int b = 0; b < 256; b++){
+      int k = 0;
+      for(int i = 0; i < 8; i++)
+        if((b >> i) & 1)
+          pos[b][k++] = i;
+      for(; k < 8; k++)
+        pos[b][k] = 8;
+    }
+  }
+};
+
+inline const natSelectTable& nat_select_table(){
+  static const natSelectTable table;
+  return table;
+}
+
+// 0-based position of the idx-th bit (0-based) set to 1 in a 64 bit word, which
+// has to have more than idx bits set. With BMI2 it is a single pdep, otherwise
+// the byte that holds the bit is found by its popcount and the bit is looked
+// up in the table.
+inline int nat_select_bit64(uint64_t x, int idx){
+#if defined(__GNUC__) && defined(__BMI2__)
+  return __builtin_ctzll(__builtin_ia32_pdep_di(1ULL << idx, x));
+#else
+  int shift = 0, c;
+
+  while((c = nat_bitcount((uint64_t)((x >> shift) & 0xFF))) <= idx){
+    idx -= c;
+    shift += 8;
+  }
+
+  return shift + nat_select_table().pos[(x >> shift) & 0xFF][idx];
+#endif
+}
+
+// Position of the idx-th bit (0-based) set to 1 in x, counting from the least
+// significant one. Positions are 1-based, as in the time slices of the arcs.
+template <typename W>
+inline int nat_select_bit(W x, int idx){
+  return nat_select_bit64((uint64_t)x, idx) + 1;
+}
+
+template <int N>
+inline int nat_select_bit(const natBitset<N> &x, int idx){
+  int i = 0, c;
+
+  while((c = nat_bitcount(x.w[i])) <= idx){
+    idx -= c;
+    i++;
+  }
+
+  return 64 * i + nat_select_bit64(x.w[i], idx) + 1;
+}
+
+// Dispatch of the word constructors that differ between integers and bitsets
+template <typename W>
+struct natWordOps {
+  static W bit(int k){return nat_bit<W>(k);}
+  static W low_mask(int n){return nat_low_mask<W>(n);}
+};
+
+template <int N>
+struct natWordOps<natBitset<N>> {
+  static natBitset<N> bit(int k){return nat_bit_bs<N>(k);}
+  static natBitset<N> low_mask(int n){return nat_low_mask_bs<N>(n);}
+};
+
+// Number of 32 bit chunks of a word, used to build hash keys
+template <typename W>
+struct natWordChunks {static const int value = sizeof(W) <= 4 ? 1 : sizeof(W) / 4;};
+
+template <typename W>
+inline uint32_t nat_word_chunk(const W &x, int c){return static_cast<uint32_t>((uint64_t)x >> (32 * c));}
+
+template <int N>
+inline uint32_t nat_word_chunk(const natBitset<N> &x, int c){return static_cast<uint32_t>(x.w[c / 2] >> (32 * (c % 2)));}
+
+// Value of a word as a double, as the causal lists are stored in R. Exact
+// while the word fits in the 53 bits of the mantissa.
+template <typename W>
+inline double nat_word_to_double(const W &x){return static_cast<double>(x);}
+
+template <int N>
+inline double nat_word_to_double(const natBitset<N> &x){
+  double res = 0;
+  for(int i = N - 1; i >= 0; i--)
+    res = res * 18446744073709551616.0 + static_cast<double>(x.w[i]);
+  return res;
+}
+
+// Word type used to operate on each storage type. The doubles of R are
+// handled as 64 bit integers.
+template <typename T>
+struct natWord {typedef T type;};
+
+template <>
+struct natWord<double> {typedef uint64_t type;};
+
+template <typename W, typename T>
+inline W nat_to_word(const T &x){return static_cast<W>(x);}
+
+template <typename W>
+inline W nat_to_word(const double &x){return static_cast<W>(static_cast<uint64_t>(x));}
+
+template <typename T, typename W>
+inline T nat_from_word(const W &x){return static_cast<T>(x);}
+
+#endif
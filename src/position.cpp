@@ -1,32 +1,76 @@
 #include "include/position.h"
 
-//' Create a natural causal list from a DBN. This is the C++ backend of the function.
-//' 
-//' @param cl an initialized causality list
-//' @param net a dbn object treated as a list of lists
-//' @param ordering a vector with the names of the variables in order
-//' @return the natCauslist equivalent to the DBN
-// [[Rcpp::export]]
-Rcpp::NumericVector create_natcauslist_cpp(Rcpp::NumericVector &cl, Rcpp::List &net, StringVector &ordering) {
+// Insert the arcs of a DBN into a causal list
+// 
+// @param cl an initialized causality list
+// @param net the nodes of a dbn object treated as a list of lists
+// @param ordering a vector with the names of the variables in t_0 in order
+// @param index the index of the variables of the ordering, see nat_name_index
+// @param max_size the maximum size of the network. The causal lists in R are
+// doubles, which hold integers of up to 53 bits, so it is limited to 54
+void nat_net_to_cl(Rcpp::NumericVector &cl, const Rcpp::List &net, const StringVector &ordering,
+                   const natNameIndex &index, int max_size){
   Rcpp::List aux;
   Rcpp::StringVector parents;
   std::string node;
-    
-  // Translation into natural causal list
+  
+  if(max_size > 54)
+    Rcpp::stop("Positions in R are limited to a max_size of 54.");
+  
   for(int i = 0; i < ordering.size(); i++){
     node = ordering[i];
     aux = net[node];
     parents = aux["parents"];
-
+    
     for(int j = 0; j < parents.size(); j++){
       node = parents[j];
-      insert_node_natcl(cl, ordering, node, i);
+      insert_node_natcl(cl, index, node, i, max_size);
     }
   }
+}
+
+//' Create a natural causal list from a DBN. This is the C++ backend of the function.
+//' 
+//' @param cl an initialized causality list
+//' @param net a dbn object treated as a list of lists
+//' @param ordering a vector with the names of the variables in order
+//' @param max_size the maximum size of the network
+//' @return the natCauslist equivalent to the DBN
+// [[Rcpp::export]]
+Rcpp::NumericVector create_natcauslist_cpp(Rcpp::NumericVector &cl, Rcpp::List &net, StringVector &ordering, int max_size) {
+  natNameIndex index = nat_name_index(ordering);
+  
+  // Translation into natural causal list
+  nat_net_to_cl(cl, net, ordering, index, max_size);
   
   return cl;
 }
 
+//' Translate several DBNs into positions at once
+//' 
+//' The names of the variables are hashed once and shared by all the networks.
+//' 
+//' @param nets a list of dbn objects
+//' @param ordering a vector with the names of the variables in t_0 in order
+//' @param max_size the maximum size of the network
+//' @return a matrix with the causal list of each network in its columns
+// [[Rcpp::export]]
+Rcpp::NumericMatrix nat_nets_to_positions_cpp(const Rcpp::List &nets, StringVector &ordering, int max_size){
+  natNameIndex index = nat_name_index(ordering);
+  int len = ordering.size() * ordering.size();
+  Rcpp::NumericMatrix res(len, nets.size());
+  
+  for(int k = 0; k < nets.size(); k++){
+    Rcpp::List net = nets[k];
+    Rcpp::List nodes = net["nodes"];
+    Rcpp::NumericVector cl(len);
+    nat_net_to_cl(cl, nodes, ordering, index, max_size);
+    std::copy(cl.begin(), cl.end(), res.begin() + (size_t)k * len);
+  }
+  
+  return res;
+}
+
 //' Create a matrix with the arcs defined in a causlist object
 //' 
 //' @param cl a causal list
@@ -37,7 +81,8 @@ Rcpp::NumericVector create_natcauslist_cpp(Rcpp::NumericVector &cl, Rcpp::List &
 Rcpp::CharacterMatrix cl_to_arc_matrix_cpp(const Rcpp::NumericVector &cl, Rcpp::CharacterVector &ordering,
                                            unsigned int rows){
   Rcpp::StringMatrix res (rows, 2);
-  int slice, j, k;
+  uint64_t slice;
+  int j, k;
   k = 0;
   
   for(int i = 0; i < cl.size(); i++){
@@ -66,20 +111,41 @@ Rcpp::CharacterMatrix cl_to_arc_matrix_cpp(const Rcpp::NumericVector &cl, Rcpp::
 //' @return the new position by reference and the new number of arcs by return
 // [[Rcpp::export]]
 int nat_pos_plus_vel_cpp(Rcpp::NumericVector &cl, const Rcpp::NumericVector &vl, const Rcpp::NumericVector &vl_neg, int n_arcs){
-  int pos, new_pos, vl_i, vl_neg_i, n_prev, n_post;
+  return nat_pos_plus_vel(cl.begin(), vl.begin(), vl_neg.begin(), cl.size(), n_arcs);
+}
+
+//' Generate a random position
+//' 
+//' The arcs are sampled from a truncated geometric distribution or a uniform
+//' one if p is lesser or equal to 0.
+//' 
+//' @param n_vars the number of variables in t_0
+//' @param max_size the maximum size of the network
+//' @param p the parameter of the truncated geometric sampler
+//' @return the position's causal list
+// [[Rcpp::export]]
+Rcpp::NumericVector nat_random_position_cpp(int n_vars, int max_size, double p){
+  Rcpp::NumericVector res(n_vars * n_vars);
+  natRRng rng;
   
-  for(int i = 0; i < cl.size(); i++){
-    pos = cl[i];
-    vl_i = vl[i];
-    vl_neg_i = vl_neg[i];
-    new_pos = pos | vl_i;
-    new_pos = bitwise_sub(new_pos, vl_neg_i);
-    n_prev = bitcount(pos);
-    n_post = bitcount(new_pos);
-    
-    cl[i] = new_pos;
-    n_arcs += n_post - n_prev;
-  }
+  nat_random_position(res.begin(), res.size(), max_size, p, rng);
+  
+  return res;
+}
+
+//' Remove random parents of the nodes with more than a maximum
+//' 
+//' @param cl the position's causal list
+//' @param max_parents maximum number of parents of each node
+//' @param n_arcs number of arcs present in the position
+//' @return the new position by reference and the new number of arcs by return
+// [[Rcpp::export]]
+int nat_cap_parents_cpp(Rcpp::NumericVector &cl, int max_parents, int n_arcs){
+  int n_vars = std::sqrt((double)cl.size());
+  natRRng rng;
+  
+  for(int i = 0; i < n_vars; i++)
+    n_arcs -= nat_cap_parents(&cl[i * n_vars], n_vars, max_parents, rng);
   
   return n_arcs;
 }
\ No newline at end of file
@@ -0,0 +1,406 @@
+#include "include/score_r.h"
+
+// Create the scorer of the statistics of a Gaussian dataset for the score
+// chosen in R
+//
+// @param stats the sufficient statistics of the folded columns
+// @param n_cols total number of nodes in the network
+// @param n_vars number of variables in t_0
+// @param max_size maximum number of timeslices of the DBN
+// @param iss_mu imaginary sample size for the prior of the mean of BGe
+// @param iss_w imaginary sample size for the prior of the precision matrix of BGe
+// @param cache_size maximum number of family scores kept in the cache
+// @param score "bge", "bic", "aic" or "loglik"
+// @return the new scorer
+natScoreBase* nat_new_gaussian_scorer(std::shared_ptr<const natSuffStats> stats, int n_cols, int n_vars, int max_size,
+                                      double iss_mu, double iss_w, double cache_size, const std::string &score){
+  natLikPenalty penalty;
+  
+  // A missing or infinite value spreads to the mean of its column, and from
+  // the scatter matrix to the score of every family with that column
+  for(int i = 0; i < stats->get_n_cols(); i++)
+    if(!std::isfinite(stats->get_mean(i)))
+      Rcpp::stop("The dataset has missing or infinite values.");
+  
+  if(score == "bge")
+    return new natBgeScore(natBgePolicy(stats, n_cols, n_vars, max_size, iss_mu, iss_w), (size_t)cache_size);
+  else if(score == "bic")
+    penalty = NAT_PENALTY_BIC;
+  else if(score == "aic")
+    penalty = NAT_PENALTY_AIC;
+  else if(score == "loglik")
+    penalty = NAT_PENALTY_NONE;
+  else
+    Rcpp::stop("The score " + score + " is not available for continuous data.");
+  
+  return new natGaussLikScore(natGaussLikPolicy(stats, n_vars, max_size, penalty), (size_t)cache_size);
+}
+
+// Create the scorer of a discrete dataset for the score chosen in R
+//
+// @param data the encoded folded columns
+// @param n_vars number of variables in t_0
+// @param max_size maximum number of timeslices of the DBN
+// @param iss imaginary sample size of BDeu
+// @param cache_size maximum number of family scores kept in the cache
+// @param count_cache memory in MB of the cache of parent configurations
+// @param score "bde", "bic", "aic" or "loglik"
+// @return the new scorer
+natScoreBase* nat_new_discrete_scorer(std::shared_ptr<const natCodedData> data, int n_vars, int max_size,
+                                      double iss, double cache_size, double count_cache, const std::string &score){
+  natDiscreteKind kind;
+  
+  if(score == "bde")
+    kind = NAT_DISCRETE_BDE;
+  else if(score == "bic")
+    kind = NAT_DISCRETE_BIC;
+  else if(score == "aic")
+    kind = NAT_DISCRETE_AIC;
+  else if(score == "loglik")
+    kind = NAT_DISCRETE_LOGLIK;
+  else
+    Rcpp::stop("The score " + score + " is not available for discrete data.");
+  
+  return new natDiscreteScore(natDiscretePolicy(data, n_vars, max_size, kind, iss, (size_t)(count_cache * 1048576)),
+                              (size_t)cache_size);
+}
+
+// Number of levels of each folded column, which have to fit in the byte of
+// the codes of natCodedData
+std::vector<int> nat_coded_levels(const Rcpp::IntegerVector &levels, const std::vector<int> &cols){
+  std::vector<int> res(cols.size());
+  
+  for(size_t i = 0; i < cols.size(); i++){
+    res[i] = levels[cols[i]];
+    if(res[i] < 1 || res[i] > 256)
+      Rcpp::stop("The factors of a discrete dataset need between 1 and 256 levels.");
+  }
+  
+  return res;
+}
+
+//' Create a native scorer from a folded dataset
+//' 
+//' The dataset is read only once to build the mean vector and the scatter
+//' matrix of the folded columns. The scorer only keeps those statistics, and
+//' it is returned as an external pointer that the rest of the scoring
+//' functions receive.
+//' 
+//' @param dt a data.table or list with the columns of the folded dataset
+//' @param col_idx integer matrix with the 0-based column of the variable j in the time slice k in its position (j, k)
+//' @param iss_mu imaginary sample size for the prior of the mean
+//' @param iss_w imaginary sample size for the prior of the precision matrix
+//' @param cache_size maximum number of family scores kept in the cache. 0 disables it
+//' @param score the score: "bge", "bic", "aic" or "loglik"
+//' @return an external pointer to the scorer
+// [[Rcpp::export]]
+SEXP create_gaussian_scorer_cpp(const Rcpp::List &dt, const Rcpp::IntegerMatrix &col_idx,
+                                double iss_mu, double iss_w, double cache_size, std::string score){
+  int n_vars = col_idx.nrow();
+  int max_size = col_idx.ncol();
+  std::shared_ptr<natSuffStats> stats = std::make_shared<natSuffStats>(n_vars * max_size);
+  std::vector<Rcpp::NumericVector> cols(n_vars * max_size);
+  std::vector<const double *> cols_ptr(n_vars * max_size);
+  
+  // Folded column k * n_vars + j holds the variable j in the time slice k
+  for(int i = 0; i < n_vars * max_size; i++){
+    cols[i] = dt[col_idx[i]];
+    cols_ptr[i] = cols[i].begin();
+  }
+  stats->add_columns(cols_ptr, cols[0].size());
+  
+  natScoreBase *scorer = nat_new_gaussian_scorer(stats, dt.size(), n_vars, max_size,
+                                                 iss_mu, iss_w, cache_size, score);
+
+  return Rcpp::XPtr<natScoreBase>(scorer, true);
+}
+
+//' Create a native scorer from a raw, unfolded dataset
+//' 
+//' The sufficient statistics of the folded columns are computed directly
+//' from the series, so the folded dataset is never built. Each run of rows
+//' with the same id is an independent sequence, and its rows have to be in
+//' time order. Sequences shorter than max_size are skipped.
+//' 
+//' @param dt a data.table or list with the columns of the raw dataset
+//' @param var_idx the 0-based column of each variable in t_0
+//' @param id an integer id of the sequence of each row. If empty, all the rows belong to a single sequence
+//' @param max_size maximum number of timeslices of the DBN
+//' @param iss_mu imaginary sample size for the prior of the mean
+//' @param iss_w imaginary sample size for the prior of the precision matrix
+//' @param cache_size maximum number of family scores kept in the cache. 0 disables it
+//' @param score the score: "bge", "bic", "aic" or "loglik"
+//' @return an external pointer to the scorer
+// [[Rcpp::export]]
+SEXP create_gaussian_scorer_raw_cpp(const Rcpp::List &dt, const Rcpp::IntegerVector &var_idx, const Rcpp::IntegerVector &id,
+                                    int max_size, double iss_mu, double iss_w, double cache_size, std::string score){
+  int n_vars = var_idx.size();
+  std::shared_ptr<natSuffStats> stats = std::make_shared<natSuffStats>(n_vars * max_size);
+  std::vector<Rcpp::NumericVector> cols(n_vars);
+  std::vector<const double *> series(n_vars);
+  size_t n_rows, first, last;
+  
+  for(int j = 0; j < n_vars; j++)
+    cols[j] = dt[var_idx[j]];
+  n_rows = cols[0].size();
+  
+  if(id.size() > 0 && (size_t)id.size() != n_rows)
+    Rcpp::stop("The id column does not match the number of rows of the dataset.");
+  
+  for(first = 0; first < n_rows; first = last){
+    last = first + 1;
+    if(id.size() > 0)
+      while(last < n_rows && id[last] == id[first])
+        last++;
+    else
+      last = n_rows;
+    
+    for(int j = 0; j < n_vars; j++)
+      series[j] = cols[j].begin() + first;
+    stats->add_series(series, last - first, max_size);
+  }
+  
+  if(stats->get_n() == 0)
+    Rcpp::stop("No sequence in the dataset is long enough to fold it into max_size time slices.");
+  
+  natScoreBase *scorer = nat_new_gaussian_scorer(stats, n_vars * max_size, n_vars, max_size,
+                                                 iss_mu, iss_w, cache_size, score);
+  
+  return Rcpp::XPtr<natScoreBase>(scorer, true);
+}
+
+//' Create a native scorer from a folded dataset in a columnar binary file
+//' 
+//' The file is mapped in memory and its rows are summarized in parallel
+//' chunks, so neither the time to start nor the memory used depend on the
+//' number of rows beyond reading them once.
+//' 
+//' @param file path of the file
+//' @param col_idx integer matrix with the 0-based column of the variable j in the time slice k in its position (j, k)
+//' @param iss_mu imaginary sample size for the prior of the mean
+//' @param iss_w imaginary sample size for the prior of the precision matrix
+//' @param cache_size maximum number of family scores kept in the cache. 0 disables it
+//' @param n_threads number of threads used to compute the statistics
+//' @param score the score: "bge", "bic", "aic" or "loglik"
+//' @return an external pointer to the scorer
+// [[Rcpp::export]]
+SEXP create_gaussian_scorer_file_cpp(std::string file, const Rcpp::IntegerMatrix &col_idx, double iss_mu,
+                                     double iss_w, double cache_size, int n_threads, std::string score){
+  int n_vars = col_idx.nrow();
+  int max_size = col_idx.ncol();
+  std::vector<int> cols(col_idx.begin(), col_idx.end());
+  natColumnFile f;
+  std::string err;
+  
+  if(!f.open(file, err))
+    Rcpp::stop(err);
+  if(f.get_n_rows() == 0)
+    Rcpp::stop("The file " + file + " has no rows.");
+  
+  // The columns of col_idx are the time slices, so they are already in the
+  // order of the folded columns
+  std::shared_ptr<natSuffStats> stats = nat_file_suff_stats(f, cols, n_threads);
+  natScoreBase *scorer = nat_new_gaussian_scorer(stats, f.get_n_cols(), n_vars, max_size,
+                                                 iss_mu, iss_w, cache_size, score);
+  
+  return Rcpp::XPtr<natScoreBase>(scorer, true);
+}
+
+//' Create a native scorer from a folded discrete dataset
+//' 
+//' The factors are encoded once as one byte per row and column, and the
+//' scorer keeps that copy of the dataset instead of the R one.
+//' 
+//' @param dt a data.table or list with the columns of the folded dataset, all of them factors
+//' @param levels the number of levels of each column of dt
+//' @param col_idx integer matrix with the 0-based column of the variable j in the time slice k in its position (j, k)
+//' @param iss imaginary sample size of BDeu
+//' @param cache_size maximum number of family scores kept in the cache. 0 disables it
+//' @param count_cache memory in MB of the cache of parent configurations. 0 disables it
+//' @param score the score: "bde", "bic", "aic" or "loglik"
+//' @return an external pointer to the scorer
+// [[Rcpp::export]]
+SEXP create_discrete_scorer_cpp(const Rcpp::List &dt, const Rcpp::IntegerVector &levels, const Rcpp::IntegerMatrix &col_idx,
+                                double iss, double cache_size, double count_cache, std::string score){
+  int n_vars = col_idx.nrow();
+  int max_size = col_idx.ncol();
+  std::vector<int> idx(col_idx.begin(), col_idx.end());
+  std::vector<Rcpp::IntegerVector> cols(n_vars * max_size);
+  std::vector<const int *> cols_ptr(n_vars * max_size);
+  
+  // Folded column k * n_vars + j holds the variable j in the time slice k
+  for(int i = 0; i < n_vars * max_size; i++){
+    cols[i] = dt[idx[i]];
+    cols_ptr[i] = cols[i].begin();
+  }
+  std::shared_ptr<natCodedData> data = std::make_shared<natCodedData>(nat_coded_levels(levels, idx));
+  if(!data->add_columns(cols_ptr, cols[0].size(), 1))
+    Rcpp::stop("The dataset has missing values.");
+  
+  natScoreBase *scorer = nat_new_discrete_scorer(data, n_vars, max_size, iss, cache_size, count_cache, score);
+  
+  return Rcpp::XPtr<natScoreBase>(scorer, true);
+}
+
+//' Create a native scorer from a raw, unfolded discrete dataset
+//' 
+//' The series are folded while they are encoded, as in create_gaussian_scorer_raw_cpp.
+//' 
+//' @param dt a data.table or list with the columns of the raw dataset
+//' @param var_idx the 0-based column of each variable in t_0, all of them factors
+//' @param id an integer id of the sequence of each row. If empty, all the rows belong to a single sequence
+//' @param levels the number of levels of each variable in t_0
+//' @param max_size maximum number of timeslices of the DBN
+//' @param iss imaginary sample size of BDeu
+//' @param cache_size maximum number of family scores kept in the cache. 0 disables it
+//' @param count_cache memory in MB of the cache of parent configurations. 0 disables it
+//' @param score the score: "bde", "bic", "aic" or "loglik"
+//' @return an external pointer to the scorer
+// [[Rcpp::export]]
+SEXP create_discrete_scorer_raw_cpp(const Rcpp::List &dt, const Rcpp::IntegerVector &var_idx, const Rcpp::IntegerVector &id,
+                                    const Rcpp::IntegerVector &levels, int max_size, double iss, double cache_size,
+                                    double count_cache, std::string score){
+  int n_vars = var_idx.size();
+  std::vector<int> idx(n_vars * max_size);
+  std::vector<Rcpp::IntegerVector> cols(n_vars);
+  std::vector<const int *> series(n_vars);
+  size_t n_rows, first, last;
+  
+  // Every time slice of a variable has its levels
+  for(int i = 0; i < n_vars * max_size; i++)
+    idx[i] = i % n_vars;
+  std::shared_ptr<natCodedData> data = std::make_shared<natCodedData>(nat_coded_levels(levels, idx));
+  
+  for(int j = 0; j < n_vars; j++)
+    cols[j] = dt[var_idx[j]];
+  n_rows = cols[0].size();
+  
+  if(id.size() > 0 && (size_t)id.size() != n_rows)
+    Rcpp::stop("The id column does not match the number of rows of the dataset.");
+  
+  for(first = 0; first < n_rows; first = last){
+    last = first + 1;
+    if(id.size() > 0)
+      while(last < n_rows && id[last] == id[first])
+        last++;
+    else
+      last = n_rows;
+    
+    for(int j = 0; j < n_vars; j++)
+      series[j] = cols[j].begin() + first;
+    if(!data->add_series(series, last - first, max_size, 1))
+      Rcpp::stop("The dataset has missing values.");
+  }
+  
+  if(data->get_n() == 0)
+    Rcpp::stop("No sequence in the dataset is long enough to fold it into max_size time slices.");
+  
+  natScoreBase *scorer = nat_new_discrete_scorer(data, n_vars, max_size, iss, cache_size, count_cache, score);
+  
+  return Rcpp::XPtr<natScoreBase>(scorer, true);
+}
+
+//' Score a position with a native scorer
+//' 
+//' @param scorer an external pointer to the scorer
+//' @param cl the position's causal list
+//' @return the score of the network encoded in the position
+// [[Rcpp::export]]
+double nat_score_cpp(SEXP scorer, const Rcpp::NumericVector &cl){
+  Rcpp::XPtr<natScoreBase> sc(scorer);
+  int n_vars = sc->get_n_vars();
+
+  if(cl.size() != n_vars * n_vars)
+    Rcpp::stop("The causal list does not match the number of variables of the scorer.");
+
+  return sc->score_cl(cl.begin());
+}
+
+//' Score each family of a position with a native scorer
+//' 
+//' @param scorer an external pointer to the scorer
+//' @param cl the position's causal list
+//' @return a vector with the score of each node in t_0 given its parents
+// [[Rcpp::export]]
+Rcpp::NumericVector nat_family_scores_cpp(SEXP scorer, const Rcpp::NumericVector &cl){
+  Rcpp::XPtr<natScoreBase> sc(scorer);
+  int n_vars = sc->get_n_vars();
+  Rcpp::NumericVector res(n_vars);
+  std::vector<uint64_t> row(n_vars);
+
+  if(cl.size() != n_vars * n_vars)
+    Rcpp::stop("The causal list does not match the number of variables of the scorer.");
+
+  for(int i = 0; i < n_vars; i++){
+    for(int j = 0; j < n_vars; j++)
+      row[j] = cl[i * n_vars + j];
+    res[i] = sc->node_score(i, row.data());
+  }
+
+  return res;
+}
+
+//' Get the usage statistics of the family score cache of a scorer
+//' 
+//' @param scorer an external pointer to the scorer
+//' @return a list with the hits, misses, evictions, current size and capacity of the cache,
+//' and the hits of the persistent cache, the number of scores it had when it was opened
+//' and the number of scores added to it, which are 0 if it has none
+// [[Rcpp::export]]
+Rcpp::List nat_cache_stats_cpp(SEXP scorer){
+  Rcpp::XPtr<natScoreBase> sc(scorer);
+  natCacheStats stats;
+
+  stats.add(sc->get_cache());
+
+  return nat_cache_stats_list(stats, sc->get_store());
+}
+
+// Build the list of nat_cache_stats_cpp from the statistics of the caches
+// and the persistent cache, if any
+Rcpp::List nat_cache_stats_list(const natCacheStats &stats, const natScoreStore *store){
+  return Rcpp::List::create(Rcpp::Named("hits") = (double)stats.hits,
+                            Rcpp::Named("misses") = (double)stats.misses,
+                            Rcpp::Named("evictions") = (double)stats.evictions,
+                            Rcpp::Named("size") = (double)stats.size,
+                            Rcpp::Named("capacity") = (double)stats.capacity,
+                            Rcpp::Named("store_hits") = store ? (double)store->get_hits() : 0.0,
+                            Rcpp::Named("store_size") = store ? (double)store->get_size() : 0.0,
+                            Rcpp::Named("store_added") = store ? (double)store->get_added() : 0.0);
+}
+
+//' Open a persistent cache of the family scores of a scorer
+//' 
+//' The scores are kept in a file of the directory named after the score and the
+//' fingerprint of the dataset and the parameters of the score, so the scores of
+//' a run are only reused by later runs on the same dataset and score. The file
+//' is created if it does not exist. The families that the scorer and its
+//' clones compute are appended to it.
+//' 
+//' @param scorer an external pointer to the scorer
+//' @param dir the directory of the cache files
+//' @return the path of the file of the scorer
+// [[Rcpp::export]]
+std::string nat_open_score_store_cpp(SEXP scorer, std::string dir){
+  Rcpp::XPtr<natScoreBase> sc(scorer);
+  std::shared_ptr<natScoreStore> store = std::make_shared<natScoreStore>();
+  std::string err;
+
+  if(!store->open(dir, sc->get_name(), sc->get_fingerprint(), sc->get_cache().get_key_len(), err))
+    Rcpp::stop(err);
+  sc->set_store(store);
+
+  return store->get_path();
+}
+
+//' Write the pending scores of the persistent cache of a scorer to its file
+//' 
+//' @param scorer an external pointer to the scorer
+// [[Rcpp::export]]
+void nat_flush_score_store_cpp(SEXP scorer){
+  Rcpp::XPtr<natScoreBase> sc(scorer);
+  natScoreStore *store = sc->get_store();
+
+  if(store && !store->flush())
+    Rcpp::stop("Cannot write to the score cache " + store->get_path() + ".");
+}
@@ -0,0 +1,282 @@
+#include "include/swarm_r.h"
+
+// Create a single swarm or an island model with the type of the scorer, so
+// the swarms call its family scores without virtual dispatch
+template <class S>
+natSwarmBase* nat_new_swarm(S *scorer, int n_inds, int max_size, const natPsoParams &pso, int n_threads,
+                            int n_islands, int interval, natTopology topology, bool share_cache){
+  if(n_islands > 1)
+    return nat_create_islands(scorer, n_islands, n_inds / n_islands, max_size, pso, n_threads,
+                              interval, topology, share_cache);
+  
+  return nat_create_swarm(scorer, n_inds, max_size, pso, n_threads);
+}
+
+// Create the native swarm from the initial state of the particles
+//
+// @param scorer an external pointer to the scorer
+// @param ps matrix with the position of each particle in its columns
+// @param vl matrix with the positive part of the velocity of each particle in its columns
+// @param vl_neg matrix with the negative part of the velocity of each particle in its columns
+// @param abs_op the number of operations of the velocity of each particle
+// @param params a list with the max_size, the PSO constants in_cte, gb_cte and lb_cte, their variations in_var, gb_var and lb_var, r_probs, cte, n_threads, max_parents (0 for no limit), prune_score, whether to prune the parents over the limit by their score or randomly, and the island model parameters n_islands, interval, topology (0 ring, 1 star, 2 full) and share_cache. The particles of the island k are the columns [k * n_inds, (k + 1) * n_inds)
+natSwarmCpp::natSwarmCpp(SEXP scorer, const Rcpp::NumericMatrix &ps, const Rcpp::NumericMatrix &vl,
+                         const Rcpp::NumericMatrix &vl_neg, const Rcpp::NumericVector &abs_op, const Rcpp::List &params){
+  Rcpp::XPtr<natScoreBase> sc(scorer);
+  int n_inds = ps.ncol();
+  int len = ps.nrow();
+  int max_size = params["max_size"];
+  
+  if(len != sc->get_n_vars() * sc->get_n_vars())
+    Rcpp::stop("The positions do not match the number of variables of the scorer.");
+  // The causal lists come from R as doubles, which hold integers of up to 53 bits
+  if(max_size > 54)
+    Rcpp::stop("Swarms initialized from R are limited to a max_size of 54.");
+  
+  create(scorer, n_inds, params);
+  for(int i = 0; i < n_inds; i++)
+    swarm->set_particle(i, &ps[i * len], &vl[i * len], &vl_neg[i * len], abs_op[i]);
+  
+  // The streams of the particles are seeded from R's RNG, so set.seed() still
+  // makes the runs reproducible
+  Rcpp::RNGScope scope;
+  swarm->seed(nat_seed_from_r());
+}
+
+// Create the native swarm with random positions and velocities
+//
+// The whole swarm is initialized in a single call, with each particle drawing
+// from its own stream. The causal lists never go through R, so max_size is
+// only limited by the words of the native swarm.
+//
+// @param scorer an external pointer to the scorer
+// @param n_inds total number of particles
+// @param params the same list as in the other constructor, plus v_probs, the 
+// weights of the operations {-1, 0, 1} of the velocities, and p, the parameter 
+// of the truncated geometric distribution of the arcs
+natSwarmCpp::natSwarmCpp(SEXP scorer, int n_inds, const Rcpp::List &params){
+  Rcpp::NumericVector v_probs = params["v_probs"];
+  double p = params["p"];
+  int max_size = params["max_size"];
+  
+  if(max_size > NAT_MAX_SLICES)
+    Rcpp::stop("The native swarm is limited to a max_size of " + std::to_string(NAT_MAX_SLICES) + ".");
+  if(v_probs.size() != 3)
+    Rcpp::stop("The velocity probabilities need to have 3 values.");
+  
+  create(scorer, n_inds, params);
+  Rcpp::RNGScope scope;
+  swarm->seed(nat_seed_from_r());
+  swarm->randomize(v_probs.begin(), p);
+}
+
+// Create an empty swarm or island model for the parameters in the list
+void natSwarmCpp::create(SEXP scorer, int n_inds, const Rcpp::List &params){
+  Rcpp::XPtr<natScoreBase> sc(scorer);
+  Rcpp::NumericVector r_probs = params["r_probs"];
+  natPsoParams pso;
+  int max_size = params["max_size"];
+  int n_islands = params["n_islands"];
+  int topology = params["topology"];
+  bool prune_score, share_cache = false;
+  
+  if(n_islands < 1 || n_inds % n_islands != 0)
+    Rcpp::stop("The particles cannot be split evenly between the islands.");
+  
+  pso.in_cte = params["in_cte"];
+  pso.gb_cte = params["gb_cte"];
+  pso.lb_cte = params["lb_cte"];
+  pso.in_var = params["in_var"];
+  pso.gb_var = params["gb_var"];
+  pso.lb_var = params["lb_var"];
+  pso.cte = params["cte"];
+  pso.r_min = r_probs[0];
+  pso.r_max = r_probs[1];
+  pso.max_parents = params["max_parents"];
+  prune_score = params["prune_score"];
+  pso.prune = prune_score ? NAT_PRUNE_SCORE : NAT_PRUNE_RANDOM;
+  
+  if(n_islands > 1)
+    share_cache = params["share_cache"];
+  
+  scorer_ref = scorer;
+  if(natBgeScore *bge = dynamic_cast<natBgeScore*>(sc.get()))
+    swarm.reset(nat_new_swarm(bge, n_inds, max_size, pso, params["n_threads"], n_islands,
+                              params["interval"], (natTopology)topology, share_cache));
+  else if(natGaussLikScore *lik = dynamic_cast<natGaussLikScore*>(sc.get()))
+    swarm.reset(nat_new_swarm(lik, n_inds, max_size, pso, params["n_threads"], n_islands,
+                              params["interval"], (natTopology)topology, share_cache));
+  else if(natDiscreteScore *dis = dynamic_cast<natDiscreteScore*>(sc.get()))
+    swarm.reset(nat_new_swarm(dis, n_inds, max_size, pso, params["n_threads"], n_islands,
+                              params["interval"], (natTopology)topology, share_cache));
+  else
+    Rcpp::stop(std::string("The swarm does not support the score ") + sc->get_name() + ".");
+}
+
+// Perform one iteration of the PSO over the whole swarm
+void natSwarmCpp::step(){
+  swarm->step();
+}
+
+// Evaluate the current positions of all particles
+void natSwarmCpp::evaluate(){
+  swarm->evaluate();
+}
+
+double natSwarmCpp::get_gb_scr(){
+  return swarm->get_gb_scr();
+}
+
+Rcpp::NumericVector natSwarmCpp::get_gb_ps(){
+  std::vector<double> gb_ps = swarm->get_gb_ps();
+  
+  return Rcpp::NumericVector(gb_ps.begin(), gb_ps.end());
+}
+
+// Arcs of the global best, one per row. The columns are the 1-based index of
+// the parent variable, the time slice of the parent and the 1-based index of
+// the child variable in t_0.
+Rcpp::IntegerMatrix natSwarmCpp::get_gb_arcs(){
+  std::vector<int> arcs = swarm->get_gb_arcs();
+  int n = arcs.size() / 3;
+  Rcpp::IntegerMatrix res(n, 3);
+  
+  for(int a = 0; a < n; a++){
+    res(a, 0) = arcs[3 * a] + 1;
+    res(a, 1) = arcs[3 * a + 1];
+    res(a, 2) = arcs[3 * a + 2] + 1;
+  }
+  Rcpp::colnames(res) = Rcpp::CharacterVector::create("from", "slice", "to");
+  
+  return res;
+}
+
+int natSwarmCpp::get_gb_n_arcs(){
+  return swarm->get_gb_n_arcs();
+}
+
+// Matrix with the current position of each particle in its columns
+Rcpp::NumericMatrix natSwarmCpp::get_positions(){
+  std::vector<double> ps = swarm->get_positions();
+  Rcpp::NumericMatrix res(swarm->get_len(), swarm->get_n_inds());
+  
+  std::copy(ps.begin(), ps.end(), res.begin());
+  
+  return res;
+}
+
+Rcpp::NumericVector natSwarmCpp::get_lb_scr(){
+  const std::vector<double> &lb_scr = swarm->get_lb_scr();
+  
+  return Rcpp::NumericVector(lb_scr.begin(), lb_scr.end());
+}
+
+int natSwarmCpp::get_iteration(){
+  return swarm->get_iteration();
+}
+
+// Number of bits of the words that store the causal units
+int natSwarmCpp::get_word_bits(){
+  return swarm->get_word_bits();
+}
+
+// Instruction set used by the batch kernels of the swarm
+std::string natSwarmCpp::get_isa(){
+  return nat_isa_name(swarm->get_isa());
+}
+
+// Records of the iterations performed after the first 'from' ones
+Rcpp::DataFrame natSwarmCpp::get_history(int from){
+  const std::vector<natIterStats> &history = swarm->get_history();
+  int n = std::max(0, (int)history.size() - from);
+  Rcpp::IntegerVector iteration(n);
+  Rcpp::NumericVector move_time(n), score_time(n), n_rescored(n), cache_hits(n);
+  Rcpp::NumericVector gb_scr(n), mean_abs_op(n), diversity(n);
+  
+  for(int i = 0; i < n; i++){
+    const natIterStats &s = history[from + i];
+    iteration[i] = s.iteration;
+    move_time[i] = s.move_time;
+    score_time[i] = s.score_time;
+    n_rescored[i] = s.n_rescored;
+    cache_hits[i] = s.cache_hits;
+    gb_scr[i] = s.gb_scr;
+    mean_abs_op[i] = s.mean_abs_op;
+    diversity[i] = s.diversity;
+  }
+  
+  return Rcpp::DataFrame::create(Rcpp::Named("iteration") = iteration, Rcpp::Named("move_time") = move_time,
+                                 Rcpp::Named("score_time") = score_time, Rcpp::Named("n_rescored") = n_rescored,
+                                 Rcpp::Named("cache_hits") = cache_hits, Rcpp::Named("gb_scr") = gb_scr,
+                                 Rcpp::Named("mean_abs_op") = mean_abs_op, Rcpp::Named("diversity") = diversity);
+}
+
+// Usage statistics of the caches of the swarm, as nat_cache_stats_cpp
+// returns them. With islands that do not share the cache, the ones of every
+// island are added up.
+Rcpp::List natSwarmCpp::get_cache_stats(){
+  Rcpp::XPtr<natScoreBase> sc(scorer_ref);
+  
+  return nat_cache_stats_list(swarm->get_cache_stats(), sc->get_store());
+}
+
+// Write the whole state of the swarm into a binary checkpoint
+void natSwarmCpp::save_checkpoint(std::string file){
+  natCheckpointOut out;
+  std::string err;
+  
+  if(!out.open(file, err))
+    Rcpp::stop(err);
+  swarm->save(out);
+  if(!out.close(err))
+    Rcpp::stop(err);
+}
+
+// Replace the state of the swarm by the one in a checkpoint written by a
+// swarm with the same number of particles, variables and time slices
+void natSwarmCpp::load_checkpoint(std::string file){
+  natCheckpointIn in;
+  std::string err;
+  
+  if(!in.open(file, err))
+    Rcpp::stop(err);
+  if(!swarm->load(in))
+    Rcpp::stop("The checkpoint " + file + " does not match the swarm.");
+}
+
+// Start the first particles of the swarm, or of each island, at or near the
+// positions of networks learned before
+//
+// @param priors matrix with the causal list of each prior in its columns
+// @param n_warm number of particles of each swarm that start at or near a prior
+// @param noise probability of perturbing each causal unit of the copies of the priors
+// @param p the parameter of the truncated geometric distribution of the perturbations
+void natSwarmCpp::warm_start(const Rcpp::NumericMatrix &priors, int n_warm, double noise, double p){
+  if(priors.ncol() == 0 || (size_t)priors.nrow() != swarm->get_len())
+    Rcpp::stop("The priors do not match the positions of the swarm.");
+  
+  swarm->warm_start(priors.begin(), priors.ncol(), n_warm, noise, p);
+}
+
+RCPP_MODULE(nat_swarm_module){
+  Rcpp::class_<natSwarmCpp>("natSwarmCpp")
+  .constructor<SEXP, Rcpp::NumericMatrix, Rcpp::NumericMatrix, Rcpp::NumericMatrix, Rcpp::NumericVector, Rcpp::List>()
+  .constructor<SEXP, int, Rcpp::List>()
+  .method("step", &natSwarmCpp::step, "Perform one iteration of the PSO over the whole swarm")
+  .method("evaluate", &natSwarmCpp::evaluate, "Evaluate the positions of all the particles")
+  .method("get_gb_scr", &natSwarmCpp::get_gb_scr, "Score of the global best")
+  .method("get_gb_ps", &natSwarmCpp::get_gb_ps, "Causal list of the global best")
+  .method("get_gb_arcs", &natSwarmCpp::get_gb_arcs, "Arcs of the global best as indexes")
+  .method("get_gb_n_arcs", &natSwarmCpp::get_gb_n_arcs, "Number of arcs of the global best")
+  .method("get_positions", &natSwarmCpp::get_positions, "Positions of all the particles")
+  .method("get_lb_scr", &natSwarmCpp::get_lb_scr, "Local best score of each particle")
+  .method("get_iteration", &natSwarmCpp::get_iteration, "Number of iterations performed")
+  .method("get_word_bits", &natSwarmCpp::get_word_bits, "Number of bits of the words that store the causal units")
+  .method("get_history", &natSwarmCpp::get_history, "Records of the iterations performed after the first 'from' ones")
+  .method("get_isa", &natSwarmCpp::get_isa, "Instruction set used by the batch kernels")
+  .method("get_cache_stats", &natSwarmCpp::get_cache_stats, "Usage statistics of the caches of all the scorers")
+  .method("save_checkpoint", &natSwarmCpp::save_checkpoint, "Write the state of the swarm into a checkpoint")
+  .method("load_checkpoint", &natSwarmCpp::load_checkpoint, "Read the state of the swarm from a checkpoint")
+  .method("warm_start", &natSwarmCpp::warm_start, "Start the first particles at or near known positions")
+  ;
+}
@@ -3,13 +3,14 @@
 //' One-hot encoder for natural numbers without the 0
 //' 
 //' Given a natural number, return the natural number equivalent to its
-//' one-hot encoding. Instead of pow, the '<<' operator will be used.
+//' one-hot encoding. The result is a double, as are the causal lists in R,
+//' so it is exact up to nat = 54 instead of overflowing an int after 31.
 //' Examples: 3 -> 100 -> 4, 5 -> 10000 -> 16
 //' @param nat the natural number to convert
 //' @return the converted number
 // [[Rcpp::export]]
-int one_hot_cpp(int nat){
-  return(1 << (nat - 1));
+double one_hot_cpp(int nat){
+  return std::ldexp(1.0, nat - 1);
 }
 
 // Bitcount implementation from the book 'Hacker's Delight'